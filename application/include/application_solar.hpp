@@ -2,13 +2,28 @@
 #define APPLICATION_SOLAR_HPP
 
 #include "application.hpp"
+#include "camera_buffer.hpp"
 #include "model.hpp"
 #include "structs.hpp"
+#include "texture_array.hpp"
 #include "texture_loader.hpp"
+#include "texture_manager.hpp"
+#include "virtual_texture.hpp"
+
+#include <map>
+#include <memory>
 
 // gpu representation of model
 class ApplicationSolar : public Application {
  public:
+  // ids of the uniform handles of the programs, in the order of the uniform names
+  enum uniform_id : std::size_t {
+    MODEL_MATRIX, NORMAL_MATRIX, COLOR_VECTOR,
+    COLOR_TEX, COLOR_LAYER, COLOR_SCALE, NORMAL_TEX,
+    VIRTUAL_COLOR, VIRTUAL_CACHE, VIRTUAL_INDIRECTION, VIRTUAL_SIZE, VIRTUAL_TILE, VIRTUAL_LEVELS,
+    FRAMEBUFFER_TEX, LIGHT_CENTER
+  };
+
   // allocate and initialize objects
   ApplicationSolar(std::string const& resource_path);
   // free allocated objects
@@ -16,6 +31,8 @@ class ApplicationSolar : public Application {
 
   // update uniform locations and values
   void uploadUniforms();
+  // update uniform locations and the camera block binding of a rebuilt program
+  void uploadProgramUniforms(std::string const& program_name);
   // update projection matrix
   void updateProjection();
   // calculate model matrix
@@ -23,8 +40,16 @@ class ApplicationSolar : public Application {
 
   void calculateOrbit(planet const& planet_instance) const;
 
-  // caculate and upload the model- and normal matrix
-  void uploadPlanetTransforms(planet const& planet_instance) const;
+  // caculate and upload the model- and normal matrix, returns the model matrix
+  glm::fmat4 uploadPlanetTransforms(planet const& planet_instance) const;
+  // upload layer and texcoord scale of the planet texture to the bound program
+  void uploadTextureLayer(shader_program const& program, planet const& planet_instance) const;
+  // request visible tiles of the planet virtual texture and bind it, planets without tiles use the array
+  void uploadVirtualTexture(glm::fmat4 const& model_matrix, planet const& planet_instance, float pixels_per_unit) const;
+  // choose planet level of detail from projected radius
+  std::size_t selectPlanetLod(glm::fmat4 const& model_matrix, planet const& planet_instance, float pixels_per_unit) const;
+  // draw the meshlets of the planet level of detail which are inside the frustum and face the camera
+  void drawPlanetMeshlets(glm::fmat4 const& model_matrix, model::lod const& lod) const;
   // react to key input
   void keyCallback(int key, int scancode, int action, int mods);
   //handle delta mouse movement input
@@ -46,8 +71,13 @@ class ApplicationSolar : public Application {
   void initializeTextures();
   void initializeSkybox();
   void updateView();
+  void selectProgramVariants();
+  // assign the texture units to the samplers of a linked program, samplers of different types may not share a unit
+  void uploadSamplerUnits(shader_program const& program);
 
   model_object planet_object; // cpu representation of model
+  std::vector<model::lod> m_planet_lods;
+  std::vector<model::meshlet> m_planet_meshlets;
   std::vector<planet> m_planet_list;
 
   model_object star_object;
@@ -59,14 +89,23 @@ class ApplicationSolar : public Application {
   texture_object tex_object;
   std::vector<pixel_data> m_loaded_textures;
 
-  texture_object tex_object_normal;
   std::vector<pixel_data> m_loaded_normal_mappings;
 
   model_object skybox_object;
   std::vector<glm::vec3> skybox_coordinates;
 
-  std::vector<texture_object> m_texture_objects;
+  // gpu memory of the textures below, levels of unused textures are evicted when over budget
+  mutable texture_manager m_texture_manager;
+  // normal mappings
+  std::vector<texture_handle> m_texture_objects;
   texture_object m_texture_objects_skybox;
+  // planet textures as layers of one array, bound once for all planets
+  texture_handle m_planet_texture_array;
+  std::vector<texture_array::layer> m_planet_texture_layers;
+  // streamed textures of planets with a tile pyramid, mapped to the planet name
+  std::map<std::string, std::unique_ptr<virtual_texture>> m_virtual_textures;
+  // view and projection of all programs
+  mutable camera_buffer m_camera_buffer;
 
   // buffer objects
   renderbuffer_object rb_object;
@@ -82,6 +121,13 @@ class ApplicationSolar : public Application {
   GLenum status;
 
   int shader_Mode = 1;
+  // programs used for drawing, the planet, sun and quad programs are the variants of the modes
+  shader_program const* m_quad_program = nullptr;
+  shader_program const* m_skybox_program = nullptr;
+  shader_program const* m_planet_program = nullptr;
+  shader_program const* m_sun_program = nullptr;
+  shader_program const* m_star_program = nullptr;
+  shader_program const* m_orbit_program = nullptr;
   bool greyscale_Mode = false;
   bool horizontal_Mode = false;
   bool vertical_Mode = false;
@@ -3,7 +3,11 @@
 
 #include "utils.hpp"
 #include "shader_loader.hpp"
+#include "model_generator.hpp"
 #include "model_loader.hpp"
+#include "model_meshlets.hpp"
+#include "model_optimizer.hpp"
+#include "model_quantizer.hpp"
 
 #include <glbinding/gl/gl.h>
 // use gl definitions from glbinding
@@ -17,12 +21,19 @@ using namespace gl;
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <fstream>
 #include <iostream>
+#include <utility>
 #include <math.h>
 
+// gpu memory for textures in bytes
+static std::size_t const TEXTURE_BUDGET = 256 * 1024 * 1024;
+
 ApplicationSolar::ApplicationSolar(std::string const& resource_path)
  :Application{resource_path}
  ,planet_object{}
+ ,m_planet_lods{}
+ ,m_planet_meshlets{}
  ,m_planet_list{}
  ,star_object{}
  ,m_star_list{}
@@ -30,12 +41,16 @@ ApplicationSolar::ApplicationSolar(std::string const& resource_path)
  ,m_orbit_list{}
  ,tex_object{}
  ,m_loaded_textures{}
- ,tex_object_normal{}
  ,m_loaded_normal_mappings{}
  ,skybox_object{}
  ,skybox_coordinates{}
+ ,m_texture_manager{TEXTURE_BUDGET}
  ,m_texture_objects{}
  ,m_texture_objects_skybox{}
+ ,m_planet_texture_array{}
+ ,m_planet_texture_layers{}
+ ,m_virtual_textures{}
+ ,m_camera_buffer{}
  ,rb_object{}
  ,fb_object{}
  ,quad_tex_object{}
@@ -53,121 +68,99 @@ ApplicationSolar::ApplicationSolar(std::string const& resource_path)
 }
 
 void ApplicationSolar::render() const {
+  // camera matrices changed by input since the last frame
+  m_camera_buffer.upload();
 
-  glBindFramebuffer(GL_FRAMEBUFFER, fb_object.handle);
+  // upload streamed tiles, requested in the last frame
+  for (auto const& texture : m_virtual_textures) {
+    texture.second->update();
+  }
+  // all planet textures are layers of one array, evicted levels are uploaded again when used
+  GLuint planet_textures = m_texture_manager.use(m_planet_texture_array).handle;
+  GLuint normal_texture = m_texture_objects.empty() ? 0 : m_texture_manager.use(m_texture_objects.front()).handle;
+  // uploads, evictions, rebuilt programs and the launcher change the state outside of the cache
+  m_gl_state.invalidate();
+
+  m_gl_state.bind_framebuffer(fb_object.handle);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  glEnable(GL_DEPTH_TEST);
+  m_gl_state.depth_test(true);
 
-  glDepthMask(GL_FALSE);
-  glUseProgram(m_shaders.at("skybox").handle);
-  glActiveTexture(GL_TEXTURE0);
-  // bind Texture Object to 2d texture binding point of unit
-  glBindTexture(GL_TEXTURE_CUBE_MAP, m_texture_objects_skybox.handle);
-  glBindVertexArray(skybox_object.vertex_AO);
+  m_gl_state.depth_mask(false);
+  m_gl_state.use_program(m_skybox_program->handle);
+  // bind Texture Object to cube map binding point of unit
+  m_gl_state.bind_texture(0, GL_TEXTURE_CUBE_MAP, m_texture_objects_skybox.handle);
+  m_gl_state.bind_vertex_array(skybox_object.vertex_AO);
 
-  glDrawElements(skybox_object.draw_mode, skybox_object.num_elements, model::INDEX.type, NULL);
-  glDepthMask(GL_TRUE);
+  glDrawElements(skybox_object.draw_mode, skybox_object.num_elements, skybox_object.index_type, NULL);
+  m_gl_state.depth_mask(true);
 
   // render Stars
-  glBindVertexArray(star_object.vertex_AO);
-  glUseProgram(m_shaders.at("star").handle);
+  m_gl_state.bind_vertex_array(star_object.vertex_AO);
+  m_gl_state.use_program(m_star_program->handle);
   //glDrawElements(star_object.draw_mode, star_object.num_elements, model::INDEX.type, NULL);
   glDrawArrays(star_object.draw_mode, 0, star_object.num_elements);
 
+  // size of a unit at unit distance in pixels, to select levels of detail
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  float pixels_per_unit = projection_matrix_temp[1][1] * float(viewport[3]) * 0.5f;
+
+  m_gl_state.bind_texture(0, GL_TEXTURE_2D_ARRAY, planet_textures);
+  if (!m_texture_objects.empty()) {
+    m_gl_state.bind_texture(1, GL_TEXTURE_2D, normal_texture);
+  }
   // bind shader to upload uniforms
-  glUseProgram(m_shaders.at("planet").handle);
+  m_gl_state.use_program(m_planet_program->handle);
   // iterate planet vector and create planet transforms for each planet
   for (auto const& planet : m_planet_list) {
     // calculates the orbit for each planet and moon
     calculateOrbit(planet);
     // render Orbit
-    glBindVertexArray(orbit_object.vertex_AO);
-    glUseProgram(m_shaders.at("orbit").handle);
+    m_gl_state.bind_vertex_array(orbit_object.vertex_AO);
+    m_gl_state.use_program(m_orbit_program->handle);
     glDrawArrays(orbit_object.draw_mode, 0, orbit_object.num_elements);
 
-    // activate Texture Unit to which to bind texture
-    glActiveTexture(GL_TEXTURE0);
-    // bind Texture Object to 2d texture binding point of unit
-    glBindTexture(GL_TEXTURE_2D, m_texture_objects[planet.m_texture_index].handle);
     // calculates model- and normal-matrix
-    uploadPlanetTransforms(planet);
+    glm::fmat4 model_matrix = uploadPlanetTransforms(planet);
+    if (planet.m_planet_type != _sun) {
+      uploadVirtualTexture(model_matrix, planet, pixels_per_unit);
+    }
     // bind the VAO to draw
-    glBindVertexArray(planet_object.vertex_AO);
-    // draw bound vertex array using bound shader
-    glDrawElements(planet_object.draw_mode, planet_object.num_elements, model::INDEX.type, NULL);
+    m_gl_state.bind_vertex_array(planet_object.vertex_AO);
+    // draw bound vertex array using bound shader, with the level of detail fitting the size on screen
+    drawPlanetMeshlets(model_matrix, m_planet_lods[selectPlanetLod(model_matrix, planet, pixels_per_unit)]);
   }
 
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  m_gl_state.bind_framebuffer(0);
 
-  glUseProgram(m_shaders.at("quad").handle);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, fb_tex_object.handle);
-  glUniform1i(m_shaders.at("quad").u_locs.at("FramebufferTex"), 0);
-  glUniform1i(m_shaders.at("quad").u_locs.at("HorizontalReflectionMode"), horizontal_Mode);
-  glUniform1i(m_shaders.at("quad").u_locs.at("GreyScaleMode"), greyscale_Mode);
-  glUniform1i(m_shaders.at("quad").u_locs.at("VerticalReflectionMode"), vertical_Mode);
-  glUniform1i(m_shaders.at("quad").u_locs.at("BlurMode"), blur_Mode);
-  glUniform1i(m_shaders.at("quad").u_locs.at("GodRays"), godray_Mode);
+  m_gl_state.use_program(m_quad_program->handle);
+  m_gl_state.bind_texture(0, GL_TEXTURE_2D, fb_tex_object.handle);
 
   glm::fmat4 temp = projection_matrix_temp * view_matrix_temp * model_matrix_sun;
   glm::fvec4 light_center = temp * glm::fvec4(0.0, 0.0, 0.0, 1.0);
   light_center = light_center / light_center.w; //homogen normalization
 
-  glUniform4fv(m_shaders.at("quad").u_locs.at("LightCenter"),
+  glUniform4fv(m_quad_program->u_handles[LIGHT_CENTER],
                       1, glm::value_ptr(light_center));
 
-  glBindVertexArray(quad_object.vertex_AO);
+  m_gl_state.bind_vertex_array(quad_object.vertex_AO);
   glDrawArrays(quad_object.draw_mode, 0, quad_object.num_elements);
+
+  m_texture_manager.next_frame();
 }
 
 void ApplicationSolar::updateView() {
   // vertices are transformed in camera space, so camera transform must be inverted
   glm::fmat4 view_matrix = glm::inverse(m_view_transform);
-  // upload matrix to gpu
-  glUseProgram(m_shaders.at("skybox").handle);
-  glUniformMatrix4fv(m_shaders.at("skybox").u_locs.at("ViewMatrix"),
-                      1, GL_FALSE, glm::value_ptr(view_matrix));
-
-  glUseProgram(m_shaders.at("planet").handle);
-  glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("ViewMatrix"),
-                      1, GL_FALSE, glm::value_ptr(view_matrix));
-
-  glUseProgram(m_shaders.at("sun").handle);
-  glUniformMatrix4fv(m_shaders.at("sun").u_locs.at("ViewMatrix"),
-                      1, GL_FALSE, glm::value_ptr(view_matrix));
-
-  glUseProgram(m_shaders.at("star").handle);
-  glUniformMatrix4fv(m_shaders.at("star").u_locs.at("ViewMatrix"),
-                      1, GL_FALSE, glm::value_ptr(view_matrix));
-
-  glUseProgram(m_shaders.at("orbit").handle);
-  glUniformMatrix4fv(m_shaders.at("orbit").u_locs.at("ViewMatrix"),
-                      1, GL_FALSE, glm::value_ptr(view_matrix));
+  // written to the gpu with the next frame, for all programs at once
+  m_camera_buffer.set_view(view_matrix);
 
   view_matrix_temp = view_matrix;
 }
 
 void ApplicationSolar::updateProjection() {
-  // upload matrix to gpu
-  glUseProgram(m_shaders.at("skybox").handle);
-  glUniformMatrix4fv(m_shaders.at("skybox").u_locs.at("ProjectionMatrix"),
-                      1, GL_FALSE, glm::value_ptr(m_view_projection));
-
-  glUseProgram(m_shaders.at("planet").handle);
-  glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("ProjectionMatrix"),
-                      1, GL_FALSE, glm::value_ptr(m_view_projection));
-
-  glUseProgram(m_shaders.at("sun").handle);
-  glUniformMatrix4fv(m_shaders.at("sun").u_locs.at("ProjectionMatrix"),
-                      1, GL_FALSE, glm::value_ptr(m_view_projection));
-
-  glUseProgram(m_shaders.at("star").handle);
-  glUniformMatrix4fv(m_shaders.at("star").u_locs.at("ProjectionMatrix"),
-                      1, GL_FALSE, glm::value_ptr(m_view_projection));
-
-  glUseProgram(m_shaders.at("orbit").handle);
-  glUniformMatrix4fv(m_shaders.at("orbit").u_locs.at("ProjectionMatrix"),
-                      1, GL_FALSE, glm::value_ptr(m_view_projection));
+  // written to the gpu with the next frame, for all programs at once
+  m_camera_buffer.set_projection(m_view_projection);
 
   projection_matrix_temp = m_view_projection;
 }
@@ -175,11 +168,30 @@ void ApplicationSolar::updateProjection() {
 // update uniform locations
 void ApplicationSolar::uploadUniforms() {
   updateUniformLocations();
+  for (auto const& pair : m_shaders) {
+    uploadSamplerUnits(pair.second);
+  }
 
   updateView();
   updateProjection();
 }
 
+void ApplicationSolar::uploadProgramUniforms(std::string const& program_name) {
+  // the camera block is bound again, its buffer keeps the matrices
+  updateUniformLocations(m_shaders.at(program_name));
+  uploadSamplerUnits(m_shaders.at(program_name));
+}
+
+void ApplicationSolar::uploadSamplerUnits(shader_program const& program) {
+  m_gl_state.use_program(program.handle);
+  // units match the binds in render, programs without the sampler ignore the missing handle
+  glUniform1i(program.u_handles[COLOR_TEX], 0);
+  glUniform1i(program.u_handles[NORMAL_TEX], 1);
+  glUniform1i(program.u_handles[VIRTUAL_CACHE], 2);
+  glUniform1i(program.u_handles[VIRTUAL_INDIRECTION], 3);
+  glUniform1i(program.u_handles[FRAMEBUFFER_TEX], 0);
+}
+
 // calculate a planets model matrix
 glm::fmat4 ApplicationSolar::calculatePlanetModelMatrix(glm::fmat4 model_matrix, planet const& planet_instance) const {
   model_matrix = glm::rotate(model_matrix, float(glfwGetTime() * planet_instance.m_rotation_speed), glm::fvec3{0.0f, 1.0f, 0.0f});
@@ -194,8 +206,8 @@ void ApplicationSolar::calculateOrbit(planet const& planet_instance) const {
   // compute orbit for static origin (sun)
   if (planet_instance.m_orbit_origin == "sun") {
     glm::fmat4 model_matrix = glm::scale(glm::fmat4{}, glm::fvec3 {planet_distance, planet_distance, planet_distance});
-    glUseProgram(m_shaders.at("orbit").handle);
-    glUniformMatrix4fv(m_shaders.at("orbit").u_locs.at("ModelMatrix"),
+    m_gl_state.use_program(m_orbit_program->handle);
+    glUniformMatrix4fv(m_orbit_program->u_handles[MODEL_MATRIX],
     1, GL_FALSE, glm::value_ptr(model_matrix));
 
     model_matrix_sun = model_matrix;
@@ -206,16 +218,41 @@ void ApplicationSolar::calculateOrbit(planet const& planet_instance) const {
         glm::fmat4 model_matrix = glm::rotate(glm::fmat4{}, float(glfwGetTime() * orbit_base.m_rotation_speed), glm::fvec3{0.0f, 1.0f, 0.0f});
         model_matrix = glm::translate(model_matrix, glm::fvec3 {0.0f, 0.0f, -1.0f * orbit_base.m_distance_to_origin});
         model_matrix = glm::scale(model_matrix, glm::fvec3 {planet_distance, planet_distance, planet_distance});
-        glUseProgram(m_shaders.at("orbit").handle);
-        glUniformMatrix4fv(m_shaders.at("orbit").u_locs.at("ModelMatrix"),
+        m_gl_state.use_program(m_orbit_program->handle);
+        glUniformMatrix4fv(m_orbit_program->u_handles[MODEL_MATRIX],
         1, GL_FALSE, glm::value_ptr(model_matrix));
       }
     }
   }
 }
 
+void ApplicationSolar::uploadTextureLayer(shader_program const& program, planet const& planet_instance) const {
+  texture_array::layer const& layer = m_planet_texture_layers.at(std::size_t(planet_instance.m_texture_layer));
+  glUniform1i(program.u_handles[COLOR_LAYER], GLint(layer.index));
+  glUniform2f(program.u_handles[COLOR_SCALE], layer.texcoord_scale.x, layer.texcoord_scale.y);
+}
+
+void ApplicationSolar::uploadVirtualTexture(glm::fmat4 const& model_matrix, planet const& planet_instance, float pixels_per_unit) const {
+  shader_program const& program = *m_planet_program;
+  auto texture = m_virtual_textures.find(planet_instance.m_name);
+  glUniform1i(program.u_handles[VIRTUAL_COLOR], texture != m_virtual_textures.end());
+  if (texture == m_virtual_textures.end()) {
+    return;
+  }
+  virtual_texture& tiles = *texture->second;
+  tiles.request_sphere(model_matrix, glm::fvec3{m_view_transform[3]}, pixels_per_unit);
+
+  m_gl_state.bind_texture(2, tiles.cache().target, tiles.cache().handle);
+  m_gl_state.bind_texture(3, tiles.indirection().target, tiles.indirection().handle);
+
+  tile_pyramid const& pyramid = tiles.pyramid();
+  glUniform2f(program.u_handles[VIRTUAL_SIZE], float(pyramid.levels().front().width), float(pyramid.levels().front().height));
+  glUniform3f(program.u_handles[VIRTUAL_TILE], float(pyramid.tile_size()), float(pyramid.border()), float(tiles.cache_size()));
+  glUniform1i(program.u_handles[VIRTUAL_LEVELS], GLint(pyramid.levels().size()));
+}
+
 // caculate and upload the model- and normal matrix
-void ApplicationSolar::uploadPlanetTransforms(planet const& planet_instance) const {
+glm::fmat4 ApplicationSolar::uploadPlanetTransforms(planet const& planet_instance) const {
   // create model matrix for our given planet
   glm::fmat4 model_matrix;
   glm::fmat4 orbit_matrix;
@@ -235,16 +272,14 @@ void ApplicationSolar::uploadPlanetTransforms(planet const& planet_instance) con
         model_matrix = calculatePlanetModelMatrix(model_matrix, planet_instance);
         normal_matrix = glm::inverseTranspose(glm::inverse(m_view_transform) * model_matrix);
         // upload model matrix
-        glUseProgram(m_shaders.at("planet").handle);
-        glUniform1i(m_shaders.at("planet").u_locs.at("ShaderMode"), shader_Mode);
-        glUniform3f(m_shaders.at("planet").u_locs.at("ColorVector"),
+        m_gl_state.use_program(m_planet_program->handle);
+        glUniform3f(m_planet_program->u_handles[COLOR_VECTOR],
                     planet_instance.m_planet_color.x, planet_instance.m_planet_color.y, planet_instance.m_planet_color.z);
-        glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("ModelMatrix"),
+        glUniformMatrix4fv(m_planet_program->u_handles[MODEL_MATRIX],
                            1, GL_FALSE, glm::value_ptr(model_matrix));
-        glUniform1i(m_shaders.at("planet").u_locs.at("ColorTex"), 0);
-        glUniform1i(m_shaders.at("planet").u_locs.at("NormalTex"), 1);
+        uploadTextureLayer(*m_planet_program, planet_instance);
         // extra matrix for normal transformation to keep them orthogonal to surface
-        glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("NormalMatrix"),
+        glUniformMatrix4fv(m_planet_program->u_handles[NORMAL_MATRIX],
                            1, GL_FALSE, glm::value_ptr(normal_matrix));
         break;
       }
@@ -257,14 +292,13 @@ void ApplicationSolar::uploadPlanetTransforms(planet const& planet_instance) con
     model_matrix = calculatePlanetModelMatrix(model_matrix, planet_instance);
     normal_matrix = glm::inverseTranspose(glm::inverse(m_view_transform) * model_matrix);
 
-    glUseProgram(m_shaders.at("sun").handle);
-    glUniform1i(m_shaders.at("sun").u_locs.at("ShaderMode"), shader_Mode);
-    glUniform3f(m_shaders.at("sun").u_locs.at("ColorVector"),
+    m_gl_state.use_program(m_sun_program->handle);
+    glUniform3f(m_sun_program->u_handles[COLOR_VECTOR],
                 planet_instance.m_planet_color.x, planet_instance.m_planet_color.y, planet_instance.m_planet_color.z);
-    glUniformMatrix4fv(m_shaders.at("sun").u_locs.at("ModelMatrix"),
+    glUniformMatrix4fv(m_sun_program->u_handles[MODEL_MATRIX],
                        1, GL_FALSE, glm::value_ptr(model_matrix));
-    glUniform1i(m_shaders.at("sun").u_locs.at("ColorTex"), 0);
-    glUniformMatrix4fv(m_shaders.at("sun").u_locs.at("NormalMatrix"),
+    uploadTextureLayer(*m_sun_program, planet_instance);
+    glUniformMatrix4fv(m_sun_program->u_handles[NORMAL_MATRIX],
                        1, GL_FALSE, glm::value_ptr(normal_matrix));
   } else {
     // // self rotation
@@ -274,21 +308,64 @@ void ApplicationSolar::uploadPlanetTransforms(planet const& planet_instance) con
     normal_matrix = glm::inverseTranspose(glm::inverse(m_view_transform) * model_matrix);
 
 
-    glUseProgram(m_shaders.at("planet").handle);
-    glUniform1i(m_shaders.at("planet").u_locs.at("ShaderMode"), shader_Mode);
-    glUniform3f(m_shaders.at("planet").u_locs.at("ColorVector"),
+    m_gl_state.use_program(m_planet_program->handle);
+    glUniform3f(m_planet_program->u_handles[COLOR_VECTOR],
                 planet_instance.m_planet_color.x, planet_instance.m_planet_color.y, planet_instance.m_planet_color.z);
-    glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("ModelMatrix"),
+    glUniformMatrix4fv(m_planet_program->u_handles[MODEL_MATRIX],
                        1, GL_FALSE, glm::value_ptr(model_matrix));
-    glUniform1i(m_shaders.at("planet").u_locs.at("ColorTex"), 0);
-    glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("NormalMatrix"),
+    uploadTextureLayer(*m_planet_program, planet_instance);
+    glUniformMatrix4fv(m_planet_program->u_handles[NORMAL_MATRIX],
                        1, GL_FALSE, glm::value_ptr(normal_matrix));
 
 
     // extra matrix for normal transformation to keep them orthogonal to surface
-    // glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("NormalMatrix"),
+    // glUniformMatrix4fv(m_planet_program->u_handles[NORMAL_MATRIX],
     //                   1, GL_FALSE, glm::value_ptr(normal_matrix));
   }
+  return model_matrix;
+}
+
+// coarsest level of detail whose error stays below a pixel on screen
+std::size_t ApplicationSolar::selectPlanetLod(glm::fmat4 const& model_matrix, planet const& planet_instance, float pixels_per_unit) const {
+  // planet lies at the origin of its model matrix, camera at the origin of the view transform
+  float distance = glm::length(glm::fvec3{model_matrix[3]} - glm::fvec3{m_view_transform[3]});
+  if (distance <= planet_instance.m_size) {
+    return 0;
+  }
+  float projected_radius = planet_instance.m_size / distance * pixels_per_unit;
+  std::size_t level = 0;
+  while (level + 1 < m_planet_lods.size() && m_planet_lods[level + 1].error * projected_radius < 1.0f) {
+    ++level;
+  }
+  return level;
+}
+
+void ApplicationSolar::drawPlanetMeshlets(glm::fmat4 const& model_matrix, model::lod const& lod) const {
+  // cull in model space, so the meshlet bounds need no transformation
+  glm::fvec4 planes[6];
+  model_meshlets::frustum_planes(projection_matrix_temp * view_matrix_temp * model_matrix, planes);
+  glm::fvec3 camera_position{glm::inverse(model_matrix) * m_view_transform[3]};
+  GLsizeiptr index_size = planet_object.index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+
+  // neighbouring visible meshlets are merged into one range
+  std::vector<GLsizei> counts{};
+  std::vector<GLvoid const*> offsets{};
+  std::size_t range_end = 0;
+  for (std::size_t m = lod.first_meshlet; m < lod.first_meshlet + lod.meshlet_num; ++m) {
+    model::meshlet const& meshlet = m_planet_meshlets[m];
+    if (model_meshlets::culled(meshlet, camera_position, planes)) continue;
+    if (!counts.empty() && range_end == meshlet.first_index) {
+      counts.back() += GLsizei(meshlet.index_num);
+    }
+    else {
+      counts.push_back(GLsizei(meshlet.index_num));
+      offsets.push_back((GLvoid const*)(meshlet.first_index * std::size_t(index_size)));
+    }
+    range_end = meshlet.first_index + meshlet.index_num;
+  }
+  if (!counts.empty()) {
+    glMultiDrawElements(planet_object.draw_mode, counts.data(), planet_object.index_type, offsets.data(), GLsizei(counts.size()));
+  }
 }
 
 // handle key input
@@ -364,9 +441,43 @@ void ApplicationSolar::keyCallback(int key, int scancode, int action, int mods)
       godray_Mode = true;
     }
   }
+  selectProgramVariants();
   updateView();
 }
 
+// use the program variants compiled for the selected modes
+void ApplicationSolar::selectProgramVariants() {
+  std::vector<std::string> shading{};
+  if (shader_Mode == 2) {
+    shading.push_back("TOON");
+  }
+  std::vector<std::string> effects{};
+  if (godray_Mode) {
+    effects.push_back("GODRAYS");
+  }
+  if (horizontal_Mode) {
+    effects.push_back("HORIZONTAL_REFLECTION");
+  }
+  if (vertical_Mode) {
+    effects.push_back("VERTICAL_REFLECTION");
+  }
+  if (blur_Mode) {
+    effects.push_back("BLUR");
+  }
+  if (greyscale_Mode) {
+    effects.push_back("GREYSCALE");
+  }
+  try {
+    // registered variants are built at startup, others when first selected
+    m_planet_program = &m_shaders.at(programVariant("planet", shading));
+    m_sun_program = &m_shaders.at(programVariant("sun", shading));
+    m_quad_program = &m_shaders.at(programVariant("quad", effects));
+  }
+  catch(std::exception&) {
+    // dont crash, keep the last working variants
+  }
+}
+
 // handle delta mouse movement input
 void ApplicationSolar::mouseCallback(double pos_y, double pos_x) {
 
@@ -403,13 +514,8 @@ void ApplicationSolar::loadTextures() {
   texture pluto_texture {"pluto", m_resource_path + "textures/pluto2k.png"};
   texture moon_texture {"moon", m_resource_path + "textures/moon2k.png"};
 
-  // initialize skybox textures
-  texture skybox_texture_right {"skybox", m_resource_path + "textures/skybox_right.png"};
-  texture skybox_texture_left {"skybox", m_resource_path + "textures/skybox_left.png"};
-  texture skybox_texture_top {"skybox", m_resource_path + "textures/skybox_top.png"};
-  texture skybox_texture_bottom {"skybox", m_resource_path + "textures/skybox_bottom.png"};
-  texture skybox_texture_back {"skybox", m_resource_path + "textures/skybox_back.png"};
-  texture skybox_texture_front {"skybox", m_resource_path + "textures/skybox_front.png"};
+  // skybox faces are resampled from one cross or equirectangular image
+  texture skybox_texture {"skybox", m_resource_path + "textures/skybox2k.png"};
 
   // normal mapping textures
   texture earth_normal_mapping {"earth_normal", m_resource_path + "textures/earth_normal_map2k.png"};
@@ -420,25 +526,42 @@ void ApplicationSolar::loadTextures() {
                       venus_texture, mars_texture, jupiter_texture,
                       mercury_texture, saturn_texture, uranus_texture,
                       neptune_texture, pluto_texture, moon_texture,
-                      skybox_texture_right, skybox_texture_front,
-                      skybox_texture_bottom, skybox_texture_top,
-                      skybox_texture_left, skybox_texture_back});
+                      skybox_texture});
 
   std::vector<texture> normal_map_list;
   normal_map_list.insert(normal_map_list.end(), {earth_normal_mapping});
 
-  // save loaded textures in vector
+  // decode all images concurrently, normal maps after the color textures
+  std::vector<std::string> file_paths{};
   for (auto const& texture : texture_list) {
-    pixel_data loaded_texture = texture_loader::file(texture.m_file_path);
-    std::cout << "Load " << texture.m_name << " texture!" << std::endl;
-    m_loaded_textures.push_back(loaded_texture);
+    file_paths.push_back(texture.m_file_path);
   }
-
-  // save loaded normal maps in vector
   for (auto const& texture : normal_map_list) {
-    pixel_data loaded_texture = texture_loader::file(texture.m_file_path);
-    std::cout << "Load " << texture.m_name << " texture!" << std::endl;
-    m_loaded_normal_mappings.push_back(loaded_texture);
+    file_paths.push_back(texture.m_file_path);
+  }
+  // block compress where the context supports it, bc7 for planets, bc1 for the large skybox faces
+  // and bc5 for normal maps, which hold vectors and not colors
+  texture_compression::format planet_format = utils::supports_compression(texture_compression::internal_format(texture_compression::BC7))
+                                              ? texture_compression::BC7 : texture_compression::BC1;
+  texture_compression::format skybox_format = texture_compression::BC1;
+  texture_compression::format normal_format = texture_compression::BC5;
+  if (!utils::supports_compression(texture_compression::internal_format(planet_format))) {
+    planet_format = texture_compression::NONE;
+    skybox_format = texture_compression::NONE;
+  }
+  if (!utils::supports_compression(texture_compression::internal_format(normal_format))) {
+    normal_format = texture_compression::NONE;
+  }
+  std::vector<texture_loader::options> settings(m_planet_list.size(), texture_loader::options{true, planet_format});
+  settings.resize(texture_list.size(), texture_loader::options{true, skybox_format, true});
+  settings.resize(file_paths.size(), texture_loader::options{false, normal_format});
+  std::vector<pixel_data> loaded_textures = texture_loader::files(file_paths, settings);
+
+  // save loaded textures and normal maps in vectors
+  for (std::size_t i = 0; i < loaded_textures.size(); ++i) {
+    bool normal_map = i >= texture_list.size();
+    std::cout << "Load " << (normal_map ? normal_map_list[i - texture_list.size()] : texture_list[i]).m_name << " texture!" << std::endl;
+    (normal_map ? m_loaded_normal_mappings : m_loaded_textures).push_back(std::move(loaded_textures[i]));
   }
 }
 
@@ -465,63 +588,58 @@ void ApplicationSolar::initializePlanets() {
 
 // load shader programs
 void ApplicationSolar::initializeShaderPrograms() {
+  // uniforms with handles, in the order of their ids
+  m_uniform_names = {"ModelMatrix", "NormalMatrix", "ColorVector",
+                     "ColorTex", "ColorLayer", "ColorScale", "NormalTex",
+                     "VirtualColor", "VirtualCache", "VirtualIndirection", "VirtualSize", "VirtualTile", "VirtualLevels",
+                     "FramebufferTex", "LightCenter"};
+  // view and projection are read from the shared camera buffer
+  m_uniform_blocks[camera_buffer::BLOCK] = camera_buffer::BINDING;
 
   m_shaders.emplace("quad", shader_program{m_resource_path + "shaders/quad.vert",
                                            m_resource_path + "shaders/quad.frag"});
-  m_shaders.at("quad").u_locs["FramebufferTex"] = -1;
-  m_shaders.at("quad").u_locs["HorizontalReflectionMode"] = -1;
-  m_shaders.at("quad").u_locs["GreyScaleMode"] = -1;
-  m_shaders.at("quad").u_locs["VerticalReflectionMode"] = -1;
-  m_shaders.at("quad").u_locs["BlurMode"] = -1;
-  m_shaders.at("quad").u_locs["GodRays"] = -1;
-  m_shaders.at("quad").u_locs["LightTex"] = -1;
-  m_shaders.at("quad").u_locs["LightCenter"] = -1;
 
   m_shaders.emplace("skybox", shader_program{m_resource_path + "shaders/skybox.vert",
                                            m_resource_path + "shaders/skybox.frag"});
-  m_shaders.at("skybox").u_locs["ViewMatrix"] = -1;
-  m_shaders.at("skybox").u_locs["ProjectionMatrix"] = -1;
 
   // store shader program objects in container
   m_shaders.emplace("planet", shader_program{m_resource_path + "shaders/simple.vert",
                                            m_resource_path + "shaders/simple.frag"});
-  // request uniform locations for shader program
-  // m_shaders.at("planet").u_locs["NormalMatrix"] = -1;
-  m_shaders.at("planet").u_locs["ModelMatrix"] = -1;
-  m_shaders.at("planet").u_locs["ViewMatrix"] = -1;
-  m_shaders.at("planet").u_locs["NormalMatrix"] = -1;
-  m_shaders.at("planet").u_locs["ProjectionMatrix"] = -1;
-  m_shaders.at("planet").u_locs["ColorVector"] = -1;
-  m_shaders.at("planet").u_locs["ShaderMode"] = -1;
-  m_shaders.at("planet").u_locs["ColorTex"] = -1;
-  m_shaders.at("planet").u_locs["NormalTex"] = -1;
 
   // store shader program objects in container
   m_shaders.emplace("sun", shader_program{m_resource_path + "shaders/sun.vert",
                                         m_resource_path + "shaders/sun.frag"});
-  // request uniform locations for shader program
-  m_shaders.at("sun").u_locs["ModelMatrix"] = -1;
-  m_shaders.at("sun").u_locs["ViewMatrix"] = -1;
-  m_shaders.at("sun").u_locs["ProjectionMatrix"] = -1;
-  m_shaders.at("sun").u_locs["NormalMatrix"] = -1;
-  m_shaders.at("sun").u_locs["ColorVector"] = -1;
-  m_shaders.at("sun").u_locs["ShaderMode"] = -1;
-  m_shaders.at("sun").u_locs["ColorTex"] = -1;
 
   // store star shader program objects in container
   m_shaders.emplace("star", shader_program{m_resource_path + "shaders/star.vert",
                                         m_resource_path + "shaders/star.frag"});
-  // request uniform locations for star shader program
-  m_shaders.at("star").u_locs["ViewMatrix"] = -1;
-  m_shaders.at("star").u_locs["ProjectionMatrix"] = -1;
 
   // store orbit shader program objects in container
   m_shaders.emplace("orbit", shader_program{m_resource_path + "shaders/orbit.vert",
                                         m_resource_path + "shaders/orbit.frag"});
-  // request uniform locations for orbit shader program
-  m_shaders.at("orbit").u_locs["ModelMatrix"] = -1;
-  m_shaders.at("orbit").u_locs["ViewMatrix"] = -1;
-  m_shaders.at("orbit").u_locs["ProjectionMatrix"] = -1;
+
+  // variants of all selectable modes, built with the other programs instead of on the key press selecting them
+  addProgramVariant("planet", {"TOON"});
+  addProgramVariant("sun", {"TOON"});
+  std::vector<std::string> const effects{"GODRAYS", "HORIZONTAL_REFLECTION", "VERTICAL_REFLECTION", "BLUR", "GREYSCALE"};
+  for (std::size_t mask = 1; mask < (std::size_t(1) << effects.size()); ++mask) {
+    // defines in the order selectProgramVariants lists them
+    std::vector<std::string> defines{};
+    for (std::size_t i = 0; i < effects.size(); ++i) {
+      if (mask & (std::size_t(1) << i)) {
+        defines.push_back(effects[i]);
+      }
+    }
+    addProgramVariant("quad", defines);
+  }
+
+  // programs stay at their place in the container when they are rebuilt or variants are added
+  m_quad_program = &m_shaders.at("quad");
+  m_skybox_program = &m_shaders.at("skybox");
+  m_planet_program = &m_shaders.at("planet");
+  m_sun_program = &m_shaders.at("sun");
+  m_star_program = &m_shaders.at("star");
+  m_orbit_program = &m_shaders.at("orbit");
 }
 
 // fill m_star_list with random star values for given number of stars
@@ -542,11 +660,37 @@ void ApplicationSolar::initializeOrbit() {
 
 // load models
 void ApplicationSolar::initializeGeometry() {
-  model planet_model = model_loader::obj(m_resource_path + "models/sphere.obj", model::NORMAL | model::TEXCOORD | model::TANGENT);
+  // planet is a procedural sphere, its coarser levels for small and distant bodies share the vertices of the full one
+  model planet_model = model_generator::uv_sphere(64, 32, model::NORMAL | model::TEXCOORD | model::TANGENT, 4);
+  // planet is drawn once per body, so reorder each level for the vertex cache and early depth test
+  std::vector<model_optimizer::cache_statistics> cache_before{};
+  for (auto const& lod : planet_model.lods) {
+    cache_before.push_back(model_optimizer::analyze_vertex_cache(planet_model, lod));
+  }
+  model_optimizer::optimize_overdraw(planet_model);
+  model_optimizer::optimize_vertex_fetch(planet_model);
+  for (std::size_t i = 0; i < planet_model.lods.size(); ++i) {
+    model_optimizer::cache_statistics cache_after = model_optimizer::analyze_vertex_cache(planet_model, planet_model.lods[i]);
+    std::cout << "Planet LOD " << i << " vertex cache ACMR " << cache_before[i].acmr << " -> " << cache_after.acmr
+              << ", ATVR " << cache_before[i].atvr << " -> " << cache_after.atvr << std::endl;
+  }
+  // clusters for culling the back and off-screen parts of each body
+  model_meshlets::build(planet_model);
+  m_planet_lods = planet_model.lods;
+  m_planet_meshlets = planet_model.meshlets;
+  std::cout << "Planet LOD triangles";
+  for (auto const& lod : m_planet_lods) {
+    std::cout << " " << lod.index_num / 3;
+  }
+  std::cout << std::endl;
+  std::cout << "Planet meshlets " << m_planet_meshlets.size() << std::endl;
+  // halve vertex bandwidth with packed attributes and 16 bit indices
+  model_quantizer::quantize(planet_model);
 
-  model star_model = model{m_star_list, (model::POSITION + model::NORMAL), {1}};
+  // lists are only needed to build the models, so their buffers are handed over
+  model star_model = model{std::move(m_star_list), (model::POSITION + model::NORMAL), {1}};
 
-  model orbit_model = model{m_orbit_list, (model::POSITION), {1}};
+  model orbit_model = model{std::move(m_orbit_list), (model::POSITION), {1}};
 
   // generate vertex array object
   glGenVertexArrays(1, &planet_object.vertex_AO);
@@ -558,24 +702,24 @@ void ApplicationSolar::initializeGeometry() {
   // bind this as an vertex array buffer containing all attributes
   glBindBuffer(GL_ARRAY_BUFFER, planet_object.vertex_BO);
   // configure currently bound array buffer
-  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * planet_model.data.size(), planet_model.data.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, planet_model.vertex_buffer().bytes, planet_model.vertex_buffer().ptr, GL_STATIC_DRAW);
 
   // activate first attribute on gpu
   glEnableVertexAttribArray(0);
-  // first attribute is 3 floats with no offset & stride
-  glVertexAttribPointer(0, model::POSITION.components, model::POSITION.type, GL_FALSE, planet_model.vertex_bytes, planet_model.offsets[model::POSITION]);
+  // first attribute is the packed position
+  utils::vertex_attrib_pointer(0, planet_model, model::POSITION);
   // activate second attribute on gpu
   glEnableVertexAttribArray(1);
-  // second attribute is 3 floats with no offset & stride
-  glVertexAttribPointer(1, model::NORMAL.components, model::NORMAL.type, GL_FALSE, planet_model.vertex_bytes, planet_model.offsets[model::NORMAL]);
+  // second attribute is the octahedral encoded normal
+  utils::vertex_attrib_pointer(1, planet_model, model::NORMAL);
   // activate third attribute on gpu
   glEnableVertexAttribArray(2);
-  // third attribute is 3 floats with no offset & stride
-  glVertexAttribPointer(2, model::TEXCOORD.components, model::TEXCOORD.type, GL_FALSE, planet_model.vertex_bytes, planet_model.offsets[model::TEXCOORD]);
+  // third attribute is the packed texture coordinate
+  utils::vertex_attrib_pointer(2, planet_model, model::TEXCOORD);
   // activate fourth attribute on gpu (normal mapping)
   glEnableVertexAttribArray(3);
-  // fourth attribute is 3 floats with no offset & stride
-  glVertexAttribPointer(3, model::TANGENT.components, model::TANGENT.type, GL_FALSE, planet_model.vertex_bytes, planet_model.offsets[model::TANGENT]);
+  // fourth attribute is the octahedral encoded tangent
+  utils::vertex_attrib_pointer(3, planet_model, model::TANGENT);
 
 
   // generate generic buffer
@@ -583,12 +727,15 @@ void ApplicationSolar::initializeGeometry() {
   // bind this as an vertex array buffer containing all attributes
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, planet_object.element_BO);
   // configure currently bound array buffer
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, model::INDEX.size * planet_model.indices.size(), planet_model.indices.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, planet_model.index_buffer().bytes, planet_model.index_buffer().ptr, GL_STATIC_DRAW);
 
   // store type of primitive to draw
   planet_object.draw_mode = GL_TRIANGLES;
   // transfer number of indices to model object
-  planet_object.num_elements = GLsizei(planet_model.indices.size());
+  planet_object.num_elements = GLsizei(m_planet_lods.front().index_num);
+  planet_object.index_type = planet_model.index_type;
+  // gl holds a copy of the buffers now
+  planet_model.release();
 
   // generate everything for star_model as well
   glGenVertexArrays(1, &star_object.vertex_AO);
@@ -596,18 +743,19 @@ void ApplicationSolar::initializeGeometry() {
 
   glGenBuffers(1, &star_object.vertex_BO);
   glBindBuffer(GL_ARRAY_BUFFER, star_object.vertex_BO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * star_model.data.size(), star_model.data.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, star_model.vertex_buffer().bytes, star_model.vertex_buffer().ptr, GL_STATIC_DRAW);
 
   glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, model::POSITION.components, model::POSITION.type, GL_FALSE, star_model.vertex_bytes, star_model.offsets[model::POSITION]);
+  utils::vertex_attrib_pointer(0, star_model, model::POSITION);
   glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, model::NORMAL.components, model::NORMAL.type, GL_FALSE, star_model.vertex_bytes, star_model.offsets[model::NORMAL]);
+  utils::vertex_attrib_pointer(1, star_model, model::NORMAL);
 
   glGenBuffers(1, &star_object.element_BO);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, star_object.element_BO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, model::INDEX.size * star_model.indices.size(), star_model.indices.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, star_model.index_buffer().bytes, star_model.index_buffer().ptr, GL_STATIC_DRAW);
   star_object.draw_mode = GL_POINTS;
-  star_object.num_elements = GLsizei(star_model.data.size() / 6);
+  star_object.num_elements = GLsizei(star_model.vertex_num);
+  star_model.release();
 
   // generate everything for orbit_model as well
   glGenVertexArrays(1, &orbit_object.vertex_AO);
@@ -615,17 +763,18 @@ void ApplicationSolar::initializeGeometry() {
 
   glGenBuffers(1, &orbit_object.vertex_BO);
   glBindBuffer(GL_ARRAY_BUFFER, orbit_object.vertex_BO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * orbit_model.data.size(), orbit_model.data.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, orbit_model.vertex_buffer().bytes, orbit_model.vertex_buffer().ptr, GL_STATIC_DRAW);
 
   glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, model::POSITION.components, model::POSITION.type, GL_FALSE, orbit_model.vertex_bytes, orbit_model.offsets[model::POSITION]);
+  utils::vertex_attrib_pointer(0, orbit_model, model::POSITION);
 
   glGenBuffers(1, &orbit_object.element_BO);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, orbit_object.element_BO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, model::INDEX.size * orbit_model.indices.size(), orbit_model.indices.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, orbit_model.index_buffer().bytes, orbit_model.index_buffer().ptr, GL_STATIC_DRAW);
 
   orbit_object.draw_mode = GL_LINE_LOOP;
-  orbit_object.num_elements = GLsizei(orbit_model.data.size() / 3);
+  orbit_object.num_elements = GLsizei(orbit_model.vertex_num);
+  orbit_model.release();
 
   glBindVertexArray(0);
 }
@@ -678,18 +827,18 @@ void ApplicationSolar::initializeScreenQuad() {
   // bind this as an vertex array buffer containing all attributes
   glBindBuffer(GL_ARRAY_BUFFER, quad_object.vertex_BO);
   // configure currently bound array buffer
-  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * quad_model.data.size(), quad_model.data.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, quad_model.vertex_buffer().bytes, quad_model.vertex_buffer().ptr, GL_STATIC_DRAW);
   // activate first attribute on gpu
   glEnableVertexAttribArray(0);
   // first attribute is 3 floats with no offset & stride
-  glVertexAttribPointer(0, model::POSITION.components, model::POSITION.type, GL_FALSE, quad_model.vertex_bytes, quad_model.offsets[model::POSITION]);
+  utils::vertex_attrib_pointer(0, quad_model, model::POSITION);
 
   glEnableVertexAttribArray(1);
   // first attribute is 3 floats with no offset & stride
-  glVertexAttribPointer(1, model::TEXCOORD.components, model::TEXCOORD.type, GL_FALSE, quad_model.vertex_bytes, quad_model.offsets[model::TEXCOORD]);
+  utils::vertex_attrib_pointer(1, quad_model, model::TEXCOORD);
 
   quad_object.draw_mode = GL_TRIANGLE_STRIP;
-  quad_object.num_elements = GLsizei(quad_model.indices.size());
+  quad_object.num_elements = GLsizei(quad_model.index_num());
 
   glBindVertexArray(0);
 }
@@ -700,82 +849,45 @@ void ApplicationSolar::initializeTextures() {
 
   auto num_planets = m_planet_list.size();
 
-  // Texture specification
+  // Texture specification, levels come prebuilt from the loader, planets share one array texture
+  std::vector<pixel_data const*> planet_textures{};
   for (unsigned int i = 0; i < num_planets; ++i) {
-    // 1. activate Texture Unit to which to bind texture
-    glActiveTexture(GL_TEXTURE0);
-    // 2. generate texture object
-    glGenTextures(1, &tex_object.handle);
-    // 3. bind Texture Object to 2d texture binding point of unit
-    glBindTexture(GL_TEXTURE_2D, tex_object.handle);
-    // 4. define interpolation type when fragment covers multiple texels (texture pixels)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    // 5. define interpolation type when fragment does not exactly cover one texel
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // set the wrap parameter for texture coordinate s and t
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    // 6. format Texture Object bound to the 2d binding point
-    glTexImage2D(GL_TEXTURE_2D, 0, m_loaded_textures[i].channels, GLsizei(m_loaded_textures[i].width), GLsizei(m_loaded_textures[i].height), 0,
-                 m_loaded_textures[i].channels, m_loaded_textures[i].channel_type, m_loaded_textures[i].ptr());
-
-    m_texture_objects.push_back(tex_object);
+    planet_textures.push_back(&m_loaded_textures[i]);
+  }
+  glActiveTexture(GL_TEXTURE0);
+  m_planet_texture_array = m_texture_manager.create(texture_array::pack(planet_textures, m_planet_texture_layers));
+
+  // planets with a tile pyramid from texture_tiler stream their texture instead
+  for (auto const& planet : m_planet_list) {
+    std::string pyramid_path{m_resource_path + "textures/" + planet.m_name + ".tiles"};
+    if (planet.m_planet_type == _sun || !std::ifstream{pyramid_path}) {
+      continue;
+    }
+    try {
+      glActiveTexture(GL_TEXTURE0 + 2);
+      m_virtual_textures[planet.m_name].reset(new virtual_texture{pyramid_path});
+    }
+    catch (std::exception const& e) {
+      m_virtual_textures.erase(planet.m_name);
+      std::cerr << "Virtual texture of " << planet.m_name << " not used: " << e.what() << std::endl;
+    }
   }
 
   auto num_normal_mappings = m_loaded_normal_mappings.size();
 
   // Normal mapping specification
+  glActiveTexture(GL_TEXTURE0 + 1);
   for (unsigned int i = 0; i < num_normal_mappings; ++i) {
-    // 1. activate Texture Unit to which to bind texture
-    glActiveTexture(GL_TEXTURE0 + 1);
-    // 2. generate texture object
-    glGenTextures(1, &tex_object_normal.handle);
-    // 3. bind Texture Object to 2d texture binding point of unit
-    glBindTexture(GL_TEXTURE_2D, tex_object_normal.handle);
-    // 4. define interpolation type when fragment covers multiple texels (texture pixels)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    // 5. define interpolation type when fragment does not exactly cover one texel
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // set the wrap parameter for texture coordinate s and t
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    // 6. format Texture Object bound to the 2d binding point
-    glTexImage2D(GL_TEXTURE_2D, 0, m_loaded_normal_mappings[i].channels,  GLsizei(m_loaded_normal_mappings[i].width),  GLsizei(m_loaded_normal_mappings[i].height), 0,
-                  m_loaded_normal_mappings[i].channels,  m_loaded_normal_mappings[i].channel_type,  m_loaded_normal_mappings[i].ptr());
-
-    m_texture_objects.push_back(tex_object_normal);
-  }
-
-  // 1. activate Texture Unit to which to bind texture
+    m_texture_objects.push_back(m_texture_manager.create(std::move(m_loaded_normal_mappings[i])));
+  }
+
+  // skybox faces are the layers of the image after the planet textures
   glActiveTexture(GL_TEXTURE0);
-  // 2. enables Texture Cube Map
-  //glEnable(GL_TEXTURE_CUBE_MAP);
-  // 3. generate Texture Object
-  glGenTextures(1, &m_texture_objects_skybox.handle);
-  // 4. bind Texture Object to gl texture cube map binding point of unit
-  glBindTexture(GL_TEXTURE_CUBE_MAP, m_texture_objects_skybox.handle);
-
-  // 5. set the wrap parameter for texture coordinate s, t, r
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, 0);
-
-  glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, m_loaded_textures[num_planets].channels, GLsizei(m_loaded_textures[num_planets].width), GLsizei(m_loaded_textures[num_planets].height), 0,
-    m_loaded_textures[num_planets].channels, m_loaded_textures[num_planets].channel_type, m_loaded_textures[num_planets].ptr());
-  glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_X, 0, m_loaded_textures[num_planets + 1].channels, GLsizei(m_loaded_textures[num_planets + 1].width), GLsizei(m_loaded_textures[num_planets + 1].height), 0,
-    m_loaded_textures[num_planets + 1].channels, m_loaded_textures[num_planets + 1].channel_type, m_loaded_textures[num_planets + 1].ptr());
-  glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Y, 0, m_loaded_textures[num_planets + 2].channels, GLsizei(m_loaded_textures[num_planets + 2].width), GLsizei(m_loaded_textures[num_planets + 2].height), 0,
-    m_loaded_textures[num_planets + 2].channels, m_loaded_textures[num_planets + 2].channel_type, m_loaded_textures[num_planets + 2].ptr());
-  glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, 0, m_loaded_textures[num_planets + 3].channels, GLsizei(m_loaded_textures[num_planets + 3].width), GLsizei(m_loaded_textures[num_planets + 3].height), 0,
-    m_loaded_textures[num_planets + 3].channels, m_loaded_textures[num_planets + 3].channel_type, m_loaded_textures[num_planets + 3].ptr());
-  glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 0, m_loaded_textures[num_planets + 4].channels, GLsizei(m_loaded_textures[num_planets + 4].width), GLsizei(m_loaded_textures[num_planets + 4].height), 0,
-    m_loaded_textures[num_planets + 4].channels, m_loaded_textures[num_planets + 4].channel_type, m_loaded_textures[num_planets + 4].ptr());
-  glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, m_loaded_textures[num_planets + 5].channels, GLsizei(m_loaded_textures[num_planets + 5].width), GLsizei(m_loaded_textures[num_planets + 5].height), 0,
-    m_loaded_textures[num_planets + 5].channels, m_loaded_textures[num_planets + 5].channel_type, m_loaded_textures[num_planets + 5].ptr());
+  m_texture_objects_skybox = utils::create_cube_map_object(m_loaded_textures[num_planets]);
+
+  // all textures are uploaded, the texture manager keeps its own copy for uploading evicted levels again
+  m_loaded_textures.clear();
+  m_loaded_normal_mappings.clear();
 }
 
 void ApplicationSolar::initializeSkybox() {
@@ -791,24 +903,25 @@ void ApplicationSolar::initializeSkybox() {
     // bind this as an vertex array buffer containing all attributes
     glBindBuffer(GL_ARRAY_BUFFER, skybox_object.vertex_BO);
     // configure currently bound array buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * skybox_model.data.size(), skybox_model.data.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, skybox_model.vertex_buffer().bytes, skybox_model.vertex_buffer().ptr, GL_STATIC_DRAW);
 
     // activate first attribute on gpu
     glEnableVertexAttribArray(0);
     // first attribute is 3 floats with no offset & stride
-    glVertexAttribPointer(0, model::POSITION.components, model::POSITION.type, GL_FALSE, skybox_model.vertex_bytes, skybox_model.offsets[model::POSITION]);
+    utils::vertex_attrib_pointer(0, skybox_model, model::POSITION);
 
     // generate generic buffer
     glGenBuffers(1, &skybox_object.element_BO);
     // bind this as an vertex array buffer containing all attributes
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, skybox_object.element_BO);
     // configure currently bound array buffer
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, model::INDEX.size * skybox_model.indices.size(), skybox_model.indices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, skybox_model.index_buffer().bytes, skybox_model.index_buffer().ptr, GL_STATIC_DRAW);
 
     // store type of primitive to draw
     skybox_object.draw_mode = GL_TRIANGLES;
     // transfer number of indices to model object
-    skybox_object.num_elements = GLsizei(skybox_model.indices.size());
+    skybox_object.num_elements = GLsizei(skybox_model.index_num());
+    skybox_object.index_type = skybox_model.index_type;
 
 }
 
@@ -826,6 +939,20 @@ ApplicationSolar::~ApplicationSolar() {
   glDeleteBuffers(1, &orbit_object.vertex_BO);
   glDeleteBuffers(1, &orbit_object.element_BO);
   glDeleteVertexArrays(1, &orbit_object.vertex_AO);
+
+  glDeleteBuffers(1, &skybox_object.vertex_BO);
+  glDeleteBuffers(1, &skybox_object.element_BO);
+  glDeleteVertexArrays(1, &skybox_object.vertex_AO);
+
+  glDeleteBuffers(1, &quad_object.vertex_BO);
+  glDeleteBuffers(1, &quad_object.element_BO);
+  glDeleteVertexArrays(1, &quad_object.vertex_AO);
+
+  // managed and virtual textures are deleted with their handles
+  glDeleteTextures(1, &m_texture_objects_skybox.handle);
+  glDeleteTextures(1, &fb_tex_object.handle);
+  glDeleteFramebuffers(1, &fb_object.handle);
+  glDeleteRenderbuffers(1, &rb_object.handle);
 }
 
 // exe entry point
@@ -0,0 +1,151 @@
+// compares cpu mip chain generation against glGenerateMipmap on a hidden window
+// usage: benchmark_mipmaps [image file]
+// the image is converted to every channel count, as single channel images take the scalar path
+#include "texture_loader.hpp"
+#include "thread_pool.hpp"
+#include "simd.hpp"
+
+#include <glbinding/gl/gl.h>
+#include <glbinding/Binding.h>
+// dont load gl bindings from glfw
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// time in milliseconds of fastest run
+template<typename F>
+double measure(unsigned runs, F const& func) {
+  double best = 1e30;
+  for (unsigned i = 0; i < runs; ++i) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - start;
+    best = std::min(best, time.count());
+  }
+  return best;
+}
+
+// copy of the base level, without mip chain
+pixel_data base_level(pixel_data const& image) {
+  std::uint8_t const* texels = static_cast<std::uint8_t const*>(image.ptr());
+  return pixel_data{std::vector<std::uint8_t>(texels, texels + image.levels.front().bytes),
+                    image.channels, image.channel_type, image.width, image.height};
+}
+
+// base level with the given number of channels, missing color channels are copies of the last one, missing alpha is opaque
+pixel_data with_channels(pixel_data const& image, std::size_t components) {
+  static GLenum const formats[4] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+  std::size_t source_components = image.levels.front().bytes / (image.width * image.height);
+  std::uint8_t const* texels = static_cast<std::uint8_t const*>(image.ptr());
+  std::vector<std::uint8_t> converted(image.width * image.height * components);
+  for (std::size_t i = 0; i < image.width * image.height; ++i) {
+    for (std::size_t c = 0; c < components; ++c) {
+      bool alpha = c == 3 || (components == 2 && c == 1);
+      converted[i * components + c] = alpha ? 255 : texels[i * source_components + std::min(c, std::min(source_components, std::size_t(3)) - 1)];
+    }
+  }
+  return pixel_data{std::move(converted), formats[components - 1], image.channel_type, image.width, image.height};
+}
+
+// upload the base level and let the driver filter the chain
+void gpu_mipmaps(pixel_data const& image, GLuint texture) {
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, image.channels, GLsizei(image.width), GLsizei(image.height), 0,
+               image.channels, image.channel_type, image.ptr());
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glFinish();
+}
+
+// upload the prefiltered chain
+void upload_mipmaps(pixel_data const& image, GLuint texture) {
+  glBindTexture(GL_TEXTURE_2D, texture);
+  for (std::size_t level = 0; level < image.level_num(); ++level) {
+    pixel_data::mip_level const& mip = image.levels[level];
+    glTexImage2D(GL_TEXTURE_2D, GLint(level), image.channels, GLsizei(mip.width), GLsizei(mip.height), 0,
+                 image.channels, image.channel_type, image.ptr(level));
+  }
+  glFinish();
+}
+
+// largest texel difference between the cpu chain and the driver chain
+int max_difference(pixel_data const& image, GLuint texture) {
+  glBindTexture(GL_TEXTURE_2D, texture);
+  int difference = 0;
+  for (std::size_t level = 1; level < image.level_num(); ++level) {
+    std::vector<std::uint8_t> texels(image.levels[level].bytes);
+    glGetTexImage(GL_TEXTURE_2D, GLint(level), image.channels, image.channel_type, texels.data());
+    std::uint8_t const* reference = static_cast<std::uint8_t const*>(image.ptr(level));
+    for (std::size_t i = 0; i < texels.size(); ++i) {
+      difference = std::max(difference, std::abs(int(texels[i]) - int(reference[i])));
+    }
+  }
+  return difference;
+}
+
+int main(int argc, char* argv[]) {
+  std::string file_name{};
+  if (argc > 1) {
+    file_name = argv[1];
+  }
+  else {
+    std::string exe_path{argv[0]};
+    file_name = exe_path.substr(0, exe_path.find_last_of("/\\"));
+    file_name += "/../../resources/textures/earth2k.png";
+  }
+  // decode without cache, the chain is generated below
+  pixel_data source = texture_loader::decode(file_name);
+
+  if (!glfwInit()) {
+    std::cerr << "GLFW initialization failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  glfwWindowHint(GLFW_VISIBLE, false);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, true);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  GLFWwindow* window = glfwCreateWindow(64, 64, "benchmark_mipmaps", NULL, NULL);
+  if (!window) {
+    std::cerr << "Window creation failed" << std::endl;
+    glfwTerminate();
+    return EXIT_FAILURE;
+  }
+  glfwMakeContextCurrent(window);
+  glbinding::Binding::initialize();
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+  std::cout << "worker threads: " << thread_pool::global().size() << ", simd width: " << simd::WIDTH << std::endl;
+  std::cout << file_name << " (" << source.width << "x" << source.height << ")" << std::endl;
+
+  GLuint textures[2];
+  glGenTextures(2, textures);
+  for (std::size_t components = 4; components > 0; --components) {
+    pixel_data image = with_channels(source, components);
+    pixel_data srgb_chain{};
+    pixel_data linear_chain{};
+    double time_gpu = measure(5, [&](){ gpu_mipmaps(image, textures[0]); });
+    double time_srgb = measure(5, [&](){ srgb_chain = base_level(image); texture_loader::generate_mipmaps(srgb_chain, true); });
+    double time_linear = measure(5, [&](){ linear_chain = base_level(image); texture_loader::generate_mipmaps(linear_chain, false); });
+    double time_upload = measure(5, [&](){ upload_mipmaps(srgb_chain, textures[1]); });
+    std::cout << " " << components << " channels" << (components > 1 ? " (simd)" : "") << std::endl;
+    std::cout << "  glGenerateMipmap  " << time_gpu << " ms (including base upload)" << std::endl;
+    std::cout << "  cpu srgb          " << time_srgb << " ms" << std::endl;
+    std::cout << "  cpu linear        " << time_linear << " ms" << std::endl;
+    std::cout << "  chain upload      " << time_upload << " ms" << std::endl;
+    // the driver filters the encoded values, so only the linear chain should match closely
+    std::cout << "  max difference    " << max_difference(linear_chain, textures[0]) << " linear, "
+              << max_difference(srgb_chain, textures[0]) << " srgb" << std::endl;
+  }
+
+  glDeleteTextures(2, textures);
+  glfwDestroyWindow(window);
+  glfwTerminate();
+}
@@ -0,0 +1,121 @@
+// compares obj_parser against tinyobj::LoadObj on sphere.obj and a large generated obj
+// usage: benchmark_obj [resource path] [synthetic sphere segments]
+#include "obj_parser.hpp"
+#include "thread_pool.hpp"
+
+#include "tiny_obj_loader.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// time in milliseconds of fastest run
+template<typename F>
+double measure(unsigned runs, F const& func) {
+  double best = 1e30;
+  for (unsigned i = 0; i < runs; ++i) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - start;
+    best = std::min(best, time.count());
+  }
+  return best;
+}
+
+std::vector<tinyobj::shape_t> load_tinyobj(std::string const& path) {
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+  std::string err = tinyobj::LoadObj(shapes, materials, path.c_str());
+  if (!err.empty()) {
+    throw std::logic_error("tinyobjloader: " + err);
+  }
+  return shapes;
+}
+
+bool equal(std::vector<tinyobj::shape_t> const& a, std::vector<tinyobj::shape_t> const& b) {
+  if (a.size() != b.size()) return false;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    if (a[i].name != b[i].name
+     || a[i].mesh.positions != b[i].mesh.positions
+     || a[i].mesh.normals != b[i].mesh.normals
+     || a[i].mesh.texcoords != b[i].mesh.texcoords
+     || a[i].mesh.indices != b[i].mesh.indices) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// write uv sphere with quad faces and full v/vt/vn corners
+void write_sphere(std::string const& path, unsigned segments) {
+  unsigned rings = segments / 2;
+  std::ofstream file(path);
+  file << "# generated by benchmark_obj\no Sphere\n";
+  char line[128];
+  for (unsigned r = 0; r <= rings; ++r) {
+    double theta = M_PI * r / rings;
+    for (unsigned s = 0; s <= segments; ++s) {
+      double phi = 2.0 * M_PI * s / segments;
+      double x = std::sin(theta) * std::cos(phi);
+      double y = std::cos(theta);
+      double z = std::sin(theta) * std::sin(phi);
+      std::snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\nvn %f %f %f\n",
+                    x, y, z, double(s) / segments, 1.0 - double(r) / rings, x, y, z);
+      file << line;
+    }
+  }
+  file << "s 1\n";
+  for (unsigned r = 0; r < rings; ++r) {
+    for (unsigned s = 0; s < segments; ++s) {
+      unsigned a = r * (segments + 1) + s + 1;
+      unsigned b = a + segments + 1;
+      std::snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n",
+                    a, a, a, b, b, b, b + 1, b + 1, b + 1, a + 1, a + 1, a + 1);
+      file << line;
+    }
+  }
+}
+
+void compare(std::string const& name, std::string const& path, unsigned runs) {
+  std::vector<tinyobj::shape_t> reference;
+  std::vector<tinyobj::shape_t> parsed;
+  double time_tinyobj = measure(runs, [&](){ reference = load_tinyobj(path); });
+  double time_parser = measure(runs, [&](){ parsed = obj_parser::file(path); });
+
+  std::size_t triangles = 0;
+  for (auto const& shape : parsed) {
+    triangles += shape.mesh.indices.size() / 3;
+  }
+  std::cout << name << " (" << triangles << " triangles)" << std::endl;
+  std::cout << "  tinyobj::LoadObj  " << time_tinyobj << " ms" << std::endl;
+  std::cout << "  obj_parser::file  " << time_parser << " ms" << std::endl;
+  std::cout << "  speedup           " << time_tinyobj / time_parser << "x" << std::endl;
+  std::cout << "  identical output  " << (equal(reference, parsed) ? "yes" : "NO") << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::string resource_path{};
+  if (argc > 1) {
+    resource_path = argv[1];
+  }
+  else {
+    std::string exe_path{argv[0]};
+    resource_path = exe_path.substr(0, exe_path.find_last_of("/\\"));
+    resource_path += "/../../resources/";
+  }
+  unsigned segments = argc > 2 ? unsigned(std::atoi(argv[2])) : 2000;
+
+  std::cout << "worker threads: " << thread_pool::global().size() << std::endl;
+  compare("sphere.obj", resource_path + "models/sphere.obj", 20);
+
+  std::string synthetic_path{"benchmark_synthetic.obj"};
+  write_sphere(synthetic_path, segments);
+  compare("synthetic sphere", synthetic_path, 3);
+  std::remove(synthetic_path.c_str());
+}
@@ -0,0 +1,146 @@
+// compares simd normal and tangent generation against the scalar implementation on a large generated mesh
+// usage: benchmark_tangents [synthetic sphere segments]
+#include "model_loader.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// time in milliseconds of fastest run
+template<typename F>
+double measure(unsigned runs, F const& func) {
+  double best = 1e30;
+  for (unsigned i = 0; i < runs; ++i) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - start;
+    best = std::min(best, time.count());
+  }
+  return best;
+}
+
+// uv sphere with shared vertices, without normals
+tinyobj::mesh_t sphere(unsigned segments) {
+  unsigned rings = segments / 2;
+  tinyobj::mesh_t mesh;
+  for (unsigned r = 0; r <= rings; ++r) {
+    float theta = float(M_PI) * float(r) / float(rings);
+    for (unsigned s = 0; s <= segments; ++s) {
+      float phi = 2.0f * float(M_PI) * float(s) / float(segments);
+      mesh.positions.push_back(std::sin(theta) * std::cos(phi));
+      mesh.positions.push_back(std::cos(theta));
+      mesh.positions.push_back(std::sin(theta) * std::sin(phi));
+      mesh.texcoords.push_back(float(s) / float(segments));
+      mesh.texcoords.push_back(1.0f - float(r) / float(rings));
+    }
+  }
+  for (unsigned r = 0; r < rings; ++r) {
+    for (unsigned s = 0; s < segments; ++s) {
+      unsigned a = r * (segments + 1) + s;
+      unsigned b = a + segments + 1;
+      unsigned quad[6] = {a, b, b + 1, a, b + 1, a + 1};
+      mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+    }
+  }
+  return mesh;
+}
+
+// scalar reference with intermediate glm vectors
+void scalar_normals(tinyobj::mesh_t& mesh) {
+  std::vector<glm::fvec3> positions(mesh.positions.size() / 3);
+  for (std::size_t i = 0; i < mesh.positions.size(); i += 3) {
+    positions[i / 3] = glm::fvec3{mesh.positions[i], mesh.positions[i + 1], mesh.positions[i + 2]};
+  }
+  std::vector<glm::fvec3> normals(positions.size(), glm::fvec3{0.0f});
+  for (std::size_t i = 0; i < mesh.indices.size(); i += 3) {
+    glm::fvec3 p0 = positions[mesh.indices[i]];
+    glm::fvec3 normal = glm::cross(positions[mesh.indices[i + 1]] - p0, positions[mesh.indices[i + 2]] - p0);
+    normals[mesh.indices[i]] += normal;
+    normals[mesh.indices[i + 1]] += normal;
+    normals[mesh.indices[i + 2]] += normal;
+  }
+  mesh.normals.resize(mesh.positions.size());
+  for (std::size_t i = 0; i < normals.size(); ++i) {
+    glm::fvec3 normal = glm::normalize(normals[i]);
+    mesh.normals[i * 3] = normal.x;
+    mesh.normals[i * 3 + 1] = normal.y;
+    mesh.normals[i * 3 + 2] = normal.z;
+  }
+}
+
+std::vector<glm::fvec3> scalar_tangents(tinyobj::mesh_t const& mesh) {
+  std::size_t vertex_num = mesh.positions.size() / 3;
+  std::vector<glm::fvec3> positions(vertex_num);
+  std::vector<glm::fvec3> normals(vertex_num);
+  std::vector<glm::fvec2> texcoords(vertex_num);
+  for (std::size_t i = 0; i < vertex_num; ++i) {
+    positions[i] = glm::fvec3{mesh.positions[i * 3], mesh.positions[i * 3 + 1], mesh.positions[i * 3 + 2]};
+    normals[i] = glm::fvec3{mesh.normals[i * 3], mesh.normals[i * 3 + 1], mesh.normals[i * 3 + 2]};
+    texcoords[i] = glm::fvec2{mesh.texcoords[i * 2], mesh.texcoords[i * 2 + 1]};
+  }
+  std::vector<glm::fvec3> tangents(vertex_num, glm::fvec3{0.0f});
+  for (std::size_t i = 0; i < mesh.indices.size(); i += 3) {
+    unsigned const* v = &mesh.indices[i];
+    glm::fvec3 p1 = positions[v[1]] - positions[v[0]];
+    glm::fvec3 p2 = positions[v[2]] - positions[v[0]];
+    glm::fvec2 uv1 = texcoords[v[1]] - texcoords[v[0]];
+    glm::fvec2 uv2 = texcoords[v[2]] - texcoords[v[0]];
+    float det = uv1.x * uv2.y - uv1.y * uv2.x;
+    glm::fvec3 tangent = det != 0.0f ? (p1 * uv2.y - p2 * uv1.y) / det : glm::fvec3{0.0f};
+    tangents[v[0]] += tangent;
+    tangents[v[1]] += tangent;
+    tangents[v[2]] += tangent;
+  }
+  for (std::size_t i = 0; i < vertex_num; ++i) {
+    tangents[i] = glm::normalize(tangents[i] - normals[i] * glm::dot(normals[i], tangents[i]));
+  }
+  return tangents;
+}
+
+// largest component difference of the valid reference vectors
+float max_difference(std::vector<float> const& result, std::vector<float> const& reference) {
+  float difference = 0.0f;
+  for (std::size_t i = 0; i < reference.size(); ++i) {
+    if (std::isfinite(reference[i])) {
+      difference = std::max(difference, std::abs(result[i] - reference[i]));
+    }
+  }
+  return difference;
+}
+
+int main(int argc, char* argv[]) {
+  unsigned segments = argc > 1 ? unsigned(std::atoi(argv[1])) : 2000;
+  tinyobj::mesh_t mesh = sphere(segments);
+
+  std::cout << "worker threads: " << thread_pool::global().size() << ", simd width: " << simd::WIDTH << std::endl;
+  std::cout << "synthetic sphere (" << mesh.indices.size() / 3 << " triangles)" << std::endl;
+
+  tinyobj::mesh_t reference = mesh;
+  double time_scalar_normals = measure(3, [&](){ scalar_normals(reference); });
+  double time_normals = measure(3, [&](){ model_loader::generate_normals(mesh); });
+  std::cout << "  normals scalar    " << time_scalar_normals << " ms" << std::endl;
+  std::cout << "  normals simd      " << time_normals << " ms" << std::endl;
+  std::cout << "  speedup           " << time_scalar_normals / time_normals << "x" << std::endl;
+  std::cout << "  max difference    " << max_difference(mesh.normals, reference.normals) << std::endl;
+
+  std::vector<glm::fvec3> reference_tangents;
+  std::vector<float> tangents;
+  double time_scalar_tangents = measure(3, [&](){ reference_tangents = scalar_tangents(mesh); });
+  double time_tangents = measure(3, [&](){ tangents = model_loader::generate_tangents(mesh); });
+  std::vector<float> reference_flat{};
+  for (auto const& tangent : reference_tangents) {
+    reference_flat.insert(reference_flat.end(), {tangent.x, tangent.y, tangent.z});
+  }
+  std::cout << "  tangents scalar   " << time_scalar_tangents << " ms" << std::endl;
+  std::cout << "  tangents simd     " << time_tangents << " ms" << std::endl;
+  std::cout << "  speedup           " << time_scalar_tangents / time_tangents << "x" << std::endl;
+  std::cout << "  max difference    " << max_difference(tangents, reference_flat) << std::endl;
+}
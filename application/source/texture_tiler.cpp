@@ -0,0 +1,43 @@
+// splits the mip chain of an image into a tile pyramid for virtual texturing
+// usage: texture_tiler <image file> [pyramid file] [tile size]
+#include "texture_loader.hpp"
+#include "tile_pyramid.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "usage: texture_tiler <image file> [pyramid file] [tile size]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string image_path{argv[1]};
+  // next to the image with its extension replaced
+  std::string pyramid_path{image_path.substr(0, image_path.find_last_of('.')) + ".tiles"};
+  if (argc > 2) {
+    pyramid_path = argv[2];
+  }
+  std::size_t tile_size = 120;
+  if (argc > 3) {
+    tile_size = std::size_t(std::strtoul(argv[3], nullptr, 10));
+  }
+
+  try {
+    pixel_data image{texture_loader::decode(image_path)};
+    texture_loader::generate_mipmaps(image);
+    tile_pyramid::write(image, pyramid_path, tile_size);
+
+    tile_pyramid pyramid{pyramid_path};
+    std::size_t tile_num = pyramid.levels().back().first_tile + 1;
+    std::cout << image_path << ": " << image.width << "x" << image.height << " in " << pyramid.levels().size()
+              << " levels of " << tile_num << " tiles with " << pyramid.padded_size() << " texels, written to "
+              << pyramid_path << std::endl;
+  }
+  catch (std::exception const& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
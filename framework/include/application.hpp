@@ -2,10 +2,13 @@
 #define APPLICATION_HPP
 
 #include "structs.hpp"
+#include "gl_state.hpp"
 
 #include <glm/gtc/type_precision.hpp>
 
 #include <map>
+#include <string>
+#include <vector>
 
 // gpu representation of model
 class Application {
@@ -17,6 +20,10 @@ class Application {
 
   // update uniform locations and values
   inline virtual void uploadUniforms() {};
+  // update uniform locations and values of one program after it was rebuilt, updates all by default
+  inline virtual void uploadProgramUniforms(std::string const& program_name) {
+    uploadUniforms();
+  };
   // update projection matrix
   void setProjection(glm::fmat4 const& projection_mat);
   virtual void updateProjection() = 0;
@@ -25,16 +32,33 @@ class Application {
   //handle delta mouse movement input
   inline virtual void mouseCallback(double pos_x, double pos_y) {};
 
+  // register the program built from the shaders of the named program preprocessed with the defines and return
+  // its name. registered variants are built by the launcher together with the other programs
+  std::string addProgramVariant(std::string const& name, std::vector<std::string> const& defines);
+  // name of the variant of the named program with the defines. variants which were not registered are built
+  // on first use, stalling that frame, throws exception if building fails
+  std::string programVariant(std::string const& name, std::vector<std::string> const& defines);
   // give shader programs to launcher
   virtual std::map<std::string, shader_program>& getShaderPrograms();
   // draw all objects
   virtual void render() const = 0;
+  // bound state of the last frame, with counts of issued and filtered calls
+  gl_state const& getGlState() const;
 
  protected:
   void updateUniformLocations();
+  void updateUniformLocations(shader_program& program);
 
   std::string m_resource_path;
 
+  // names of the uniforms with handles in all programs, indexed by their id
+  std::vector<std::string> m_uniform_names{};
+  // binding points of uniform blocks shared by the programs
+  std::map<std::string, GLuint> m_uniform_blocks{};
+
+  // binds go through the cache to skip redundant calls, render is const but changes the bound state
+  mutable gl_state m_gl_state{};
+
   glm::fmat4 m_view_transform;
   glm::fmat4 m_view_projection;
 
@@ -0,0 +1,47 @@
+#ifndef CAMERA_BUFFER_HPP
+#define CAMERA_BUFFER_HPP
+
+#include <glbinding/gl/types.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <glm/gtc/type_precision.hpp>
+
+// uniform buffer of the camera matrices, shared by all programs declaring the block of camera.glsl.
+// changes are written once per frame instead of to every program
+class camera_buffer {
+ public:
+  // binding point of the block, programs are bound to it after linking
+  static GLuint const BINDING = 0;
+  // name of the uniform block
+  static char const* const BLOCK;
+
+  // create buffer and bind it to the binding point, needs a current gl context
+  camera_buffer();
+  ~camera_buffer();
+
+  camera_buffer(camera_buffer const&) = delete;
+  camera_buffer& operator=(camera_buffer const&) = delete;
+
+  void set_view(glm::fmat4 const& view);
+  void set_projection(glm::fmat4 const& projection);
+  // write the matrices if they changed since the last upload
+  void upload();
+
+ private:
+  // std140 layout of the block, matrices are four aligned columns
+  struct block {
+    glm::fmat4 view;
+    glm::fmat4 projection;
+    glm::fmat4 view_projection;
+    glm::fmat4 inverse_view;
+    glm::fmat4 inverse_projection;
+    glm::fmat4 inverse_view_projection;
+  };
+
+  block m_block;
+  GLuint m_buffer;
+  bool m_changed;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef FILE_WATCHER_HPP
+#define FILE_WATCHER_HPP
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+// reports files written since the last query, without blocking. uses inotify on linux,
+// other platforms poll the modification times
+class file_watcher {
+ public:
+  // throws exception if the notification queue can not be created
+  file_watcher();
+  ~file_watcher();
+
+  file_watcher(file_watcher const&) = delete;
+  file_watcher& operator=(file_watcher const&) = delete;
+
+  // watch file for changes, watching it again has no effect
+  void watch(std::string const& file_path);
+  // watched files changed since the last call, each reported once with the path it was watched by
+  std::vector<std::string> changed();
+
+ private:
+#ifdef __linux__
+  int m_inotify;
+  // watched file paths by name, per watched directory
+  std::map<int, std::map<std::string, std::string>> m_files;
+#else
+  // watched file paths with last modification time
+  std::map<std::string, std::time_t> m_files;
+#endif
+};
+
+#endif
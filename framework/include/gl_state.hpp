@@ -0,0 +1,66 @@
+#ifndef GL_STATE_HPP
+#define GL_STATE_HPP
+
+#include <glbinding/gl/types.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <array>
+#include <cstddef>
+
+// cache of bound objects and depth state, calls which would not change the state are skipped.
+// state changed by other code, or objects deleted while bound, require an invalidate
+class gl_state {
+ public:
+  // texture units with cached bindings, binds to higher units are always issued
+  static std::size_t const UNIT_NUM = 16;
+
+  gl_state();
+
+  void use_program(GLuint program);
+  void bind_vertex_array(GLuint vertex_array);
+  void bind_framebuffer(GLuint framebuffer);
+  // binds to the unit, the active unit is only changed when the binding is
+  void bind_texture(GLuint unit, GLenum target, GLuint texture);
+  void depth_mask(bool write);
+  void depth_test(bool enable);
+
+  // forget all state, the next call of each kind is issued
+  void invalidate();
+  // forget texture bindings, after textures were bound or deleted elsewhere
+  void invalidate_textures();
+
+  // calls passed to gl
+  std::size_t issued() const;
+  // calls skipped as redundant
+  std::size_t filtered() const;
+
+ private:
+  // targets with cached bindings per unit
+  enum target_slot : std::size_t {
+    TEXTURE_2D,
+    TEXTURE_2D_ARRAY,
+    TEXTURE_CUBE_MAP,
+    TARGET_NUM
+  };
+  // value of unknown state
+  static GLuint const UNKNOWN = ~GLuint{0};
+
+  // count call, returns whether it must be issued
+  bool changes(GLuint& current, GLuint value);
+  // slot of target, TARGET_NUM if the target is not cached
+  static std::size_t slot(GLenum target);
+
+  GLuint m_program;
+  GLuint m_vertex_array;
+  GLuint m_framebuffer;
+  GLuint m_active_unit;
+  std::array<std::array<GLuint, TARGET_NUM>, UNIT_NUM> m_textures;
+  GLuint m_depth_mask;
+  GLuint m_depth_test;
+
+  std::size_t m_issued;
+  std::size_t m_filtered;
+};
+
+#endif
@@ -2,7 +2,10 @@
 #define LAUNCHER_HPP
 
 #include "application.hpp"
+#include "file_watcher.hpp"
+#include "shader_loader.hpp"
 
+#include <map>
 #include <string>
 
 // forward declarations
@@ -38,6 +41,12 @@ class Launcher {
   void update_projection(GLFWwindow* window, int width, int height);
   // load shader programs and update uniform locations
   void update_shader_programs(bool throwing);
+  // watch the shader files of all programs
+  void watch_shader_programs();
+  // start rebuilding a program in the background, replacing an unfinished build of it
+  void rebuild_shader_program(std::string const& name);
+  // rebuild programs with changed shaders and replace programs whose build finished
+  void update_changed_programs();
   // handle key input
   void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
   //handle mouse movement input
@@ -60,10 +69,17 @@ class Launcher {
   // variables for fps computation
   double m_last_second_time;
   unsigned m_frames_per_second;
+  // filtered gl calls until the last second
+  std::size_t m_filtered_calls;
 
   // path to the resource folders
   std::string m_resource_path;
 
   Application* m_application;
+
+  // shader files of the programs
+  file_watcher m_shader_watcher;
+  // programs being rebuilt, the old ones are used until they are finished
+  std::map<std::string, shader_loader::program_build> m_program_builds;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// read-only memory mapping of a whole file, unmapped on destruction
+class mapped_file {
+ public:
+  // map file, throwing exception if it can not be opened or mapped
+  mapped_file(std::string const& path);
+  ~mapped_file();
+
+  mapped_file(mapped_file const&) = delete;
+  mapped_file& operator=(mapped_file const&) = delete;
+
+  // pointer to first byte of file
+  std::uint8_t const* data() const {
+    return m_data;
+  }
+  // size of file in bytes
+  std::size_t size() const {
+    return m_size;
+  }
+
+ private:
+  std::uint8_t const* m_data;
+  std::size_t m_size;
+#ifdef _WIN32
+  void* m_file;
+  void* m_mapping;
+#endif
+};
+
+#endif
@@ -2,10 +2,17 @@
 #define MODEL_HPP
 
 #include <glbinding/gl/types.h>
+#include <glbinding/gl/boolean.h>
 #include <structs.hpp>
 
+#include <glm/vec3.hpp>
+
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <vector>
+
+class mapped_file;
 // use gl definitions from glbinding
 using namespace gl;
 
@@ -17,11 +24,13 @@ struct model {
   // type holding info about a vertex/model attribute
   struct attribute {
 
-    attribute(attrib_flag_t f, GLsizei s, GLsizei c, GLenum t)
+    attribute(attrib_flag_t f, GLsizei s, GLsizei c, GLenum t, GLboolean n = GL_FALSE)
      :flag{f}
      ,size{s}
      ,components{c}
      ,type{t}
+     ,normalized{n}
+     ,offset{nullptr}
     {}
 
     // conversion to flag type for use as enum
@@ -37,6 +46,8 @@ struct model {
     GLint components;
     // Gl type
     GLenum type;
+    // whether integer types are mapped to [0, 1] or [-1, 1]
+    GLboolean normalized;
     // offset from element beginning
     GLvoid* offset;
   };
@@ -52,18 +63,75 @@ struct model {
   // is not a vertex attribute, so not stored in VERTEX_ATTRIBS
   static attribute const  INDEX;
 
+  // contiguous range of bytes for upload
+  struct buffer_view {
+    GLvoid const* ptr;
+    std::size_t bytes;
+  };
+
+  // range in the indices drawing one level of detail, all levels share the vertices
+  struct lod {
+    std::size_t first_index;
+    std::size_t index_num;
+    // geometric deviation from the full model, relative to the model radius
+    float error;
+    // range in meshlets covering the indices of this level
+    std::size_t first_meshlet;
+    std::size_t meshlet_num;
+  };
+
+  // range in the indices with few vertices and triangles, which can be culled as a whole
+  struct meshlet {
+    std::size_t first_index;
+    std::size_t index_num;
+    // bounding sphere
+    glm::vec3 center;
+    float radius;
+    // all triangle normals lie within the cone around axis, cutoff is the cosine of its half angle
+    glm::vec3 cone_axis;
+    float cone_cutoff;
+  };
+
   model();
-  model(std::vector<GLfloat> const& databuff, attrib_flag_t attribs, std::vector<GLuint> const& trianglebuff = std::vector<GLuint>{});
-  model(std::vector<particle> const& databuff, attrib_flag_t attribs, std::vector<GLuint> const& trianglebuff = std::vector<GLuint>{});
+  // buffers are taken over without copying when passed as rvalues
+  model(std::vector<GLfloat> databuff, attrib_flag_t attribs, std::vector<GLuint> trianglebuff = std::vector<GLuint>{});
+  model(std::vector<particle> databuff, attrib_flag_t attribs, std::vector<GLuint> trianglebuff = std::vector<GLuint>{});
 
   std::vector<GLfloat> data;
   std::vector<particle> particle_data;
   std::vector<GLuint> indices;
-  // byte offsets of individual element attributes
-  std::map<attrib_flag_t, GLvoid*> offsets;
+  // layout and byte offsets of individual element attributes
+  std::map<attrib_flag_t, attribute> offsets;
   // size of one vertex element in bytes
   GLsizei vertex_bytes;
   std::size_t vertex_num;
+  // type of the indices in index_buffer()
+  GLenum index_type;
+
+  // quantized vertex bytes and 16 bit indices, used instead of data and indices when filled
+  std::vector<std::uint8_t> packed_data;
+  std::vector<GLushort> packed_indices;
+
+  // vertex and index bytes, from the vectors, the packed vectors or the mapped storage
+  buffer_view vertex_buffer() const;
+  buffer_view index_buffer() const;
+  // number of indices
+  std::size_t index_num() const;
+  // copy mapped storage into the vectors, so they can be modified
+  void unmap();
+  // free vertex and index storage once it was uploaded. layout, vertex_num, lods and meshlets stay valid,
+  // index_num() counts the freed buffer and is 0 afterwards
+  void release();
+
+  // levels of detail from finest to coarsest, empty if only the full model exists
+  std::vector<lod> lods;
+  // clusters of the indices, empty if not built
+  std::vector<meshlet> meshlets;
+
+  // external storage, e.g. a memory-mapped cache file, used instead of the vectors
+  std::shared_ptr<mapped_file> mapping;
+  buffer_view mapped_data;
+  buffer_view mapped_indices;
 };
 
 #endif
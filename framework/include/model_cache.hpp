@@ -0,0 +1,18 @@
+#ifndef MODEL_CACHE_HPP
+#define MODEL_CACHE_HPP
+
+#include "model.hpp"
+
+#include <string>
+
+// binary cache of processed models, memory-mapped on load
+namespace model_cache {
+  // path of the cache file for a source model and requested attributes
+  std::string file_path(std::string const& source_path, model::attrib_flag_t import_attribs);
+  // map cached model, returns false if no cache exists or it is outdated
+  bool load(std::string const& source_path, model::attrib_flag_t import_attribs, model& result);
+  // write model to cache, returns false if the cache file could not be written
+  bool store(std::string const& source_path, model::attrib_flag_t import_attribs, model const& source);
+};
+
+#endif
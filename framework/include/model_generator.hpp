@@ -0,0 +1,20 @@
+#ifndef MODEL_GENERATOR_HPP
+#define MODEL_GENERATOR_HPP
+
+#include "model.hpp"
+
+// procedural unit spheres around the origin, with exact normals, equirectangular texcoords
+// and tangents pointing along u. position is always contained, the other attributes if in attribs.
+// up to level_num levels of detail with halved tessellation are appended to the indices and filled in lods,
+// their error is the deviation from the exact sphere and all levels index the same vertices.
+// triangles are in generation order, model_optimizer reorders them for drawing
+namespace model_generator {
+  // rings of segments quads, with a seam column and a pole vertex per triangle fan
+  model uv_sphere(std::size_t segments, std::size_t rings, model::attrib_flag_t attribs = model::POSITION, std::size_t level_num = 1);
+  // cube with subdivisions quads along each edge, mapped to the sphere with evenly sized cells
+  model cube_sphere(std::size_t subdivisions, model::attrib_flag_t attribs = model::POSITION, std::size_t level_num = 1);
+  // icosahedron whose triangles are split into four subdivisions times
+  model icosphere(std::size_t subdivisions, model::attrib_flag_t attribs = model::POSITION, std::size_t level_num = 1);
+};
+
+#endif
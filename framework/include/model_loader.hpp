@@ -9,6 +9,11 @@ namespace model_loader {
 
 model obj(std::string const& path, model::attrib_flag_t import_attribs = model::POSITION);
 
+// area weighted vertex normals, written to the normals of the mesh
+void generate_normals(tinyobj::mesh_t& mesh);
+// vertex tangents from positions and texcoords, orthogonalized to existing normals, as flat xyz array
+std::vector<float> generate_tangents(tinyobj::mesh_t const& mesh);
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef MODEL_MESHLETS_HPP
+#define MODEL_MESHLETS_HPP
+
+#include "model.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+// clusters of triangles with bounds for coarse culling
+namespace model_meshlets {
+  // split the indices of every level of detail into meshlets of consecutive triangles
+  // with at most max_vertices unique vertices and max_triangles triangles, the index order is kept
+  void build(model& source, std::size_t max_vertices = 64, std::size_t max_triangles = 124);
+
+  // frustum planes in the space which matrix transforms to clip space, normals point inwards
+  void frustum_planes(glm::fmat4 const& matrix, glm::fvec4 (&planes)[6]);
+  // whether the meshlet lies outside the frustum or all its triangles face away from the camera,
+  // camera position and planes in model space
+  bool culled(model::meshlet const& meshlet, glm::fvec3 const& camera_position, glm::fvec4 const (&planes)[6]);
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef MODEL_OPTIMIZER_HPP
+#define MODEL_OPTIMIZER_HPP
+
+#include "model.hpp"
+
+// optional reordering of triangle models for faster drawing,
+// the triangles of each level of detail are reordered within the range of the level
+namespace model_optimizer {
+  // post-transform vertex cache efficiency
+  struct cache_statistics {
+    // average cache miss ratio, transformed vertices per triangle
+    float acmr;
+    // average transform to vertex ratio, transformed vertices per vertex
+    float atvr;
+  };
+
+  // simulate fifo post-transform vertex cache
+  cache_statistics analyze_vertex_cache(model const& source, unsigned cache_size = 16);
+  // simulate drawing only the level, relative to the vertices it uses
+  cache_statistics analyze_vertex_cache(model const& source, model::lod const& level, unsigned cache_size = 16);
+
+  // reorder triangles for vertex cache hits with tipsify
+  void optimize_vertex_cache(model& source, unsigned cache_size = 16);
+  // reorder triangles with tipsify and sort the resulting clusters so outward facing ones are drawn first,
+  // acmr of a cluster may exceed the unclustered acmr by threshold
+  void optimize_overdraw(model& source, unsigned cache_size = 16, float threshold = 1.05f);
+  // reorder vertex data in order of first use by the indices, dropping unused vertices
+  void optimize_vertex_fetch(model& source);
+};
+
+#endif
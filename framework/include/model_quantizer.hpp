@@ -0,0 +1,20 @@
+#ifndef MODEL_QUANTIZER_HPP
+#define MODEL_QUANTIZER_HPP
+
+#include "model.hpp"
+
+// optional compact vertex format to reduce vertex bandwidth
+namespace model_quantizer {
+  // repack float vertices into packed_data:
+  // positions as snorm16 if inside [-1, 1], otherwise half float,
+  // normals, tangents and bitangents as octahedral snorm16 pairs,
+  // texcoords as unorm16 if inside [0, 1], otherwise half float,
+  // indices become 16 bit if all vertices are addressable
+  void quantize(model& source);
+
+  // octahedral mapping of a unit vector to [-1, 1]^2 and back
+  void encode_octahedral(GLfloat const* vector, GLfloat* encoded);
+  void decode_octahedral(GLfloat const* encoded, GLfloat* vector);
+};
+
+#endif
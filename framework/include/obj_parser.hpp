@@ -0,0 +1,18 @@
+#ifndef OBJ_PARSER_HPP
+#define OBJ_PARSER_HPP
+
+#include "tiny_obj_loader.h"
+
+#include <string>
+#include <vector>
+
+// multi-threaded obj parser producing the same shapes as tinyobj::LoadObj,
+// material libraries are not loaded, so material ids are always -1
+namespace obj_parser {
+  // parse file, throwing exception if it can not be read
+  std::vector<tinyobj::shape_t> file(std::string const& path);
+  // parse obj text in memory
+  std::vector<tinyobj::shape_t> parse(char const* text, std::size_t length);
+};
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <cstdint>
+#include <memory>
+#include <utility>
 
 // #include <glbinding/gl/types.h>
 #include <glbinding/gl/enum.h>
@@ -11,6 +13,14 @@ using namespace gl;
 
 // holds texture data and format information
 struct pixel_data {
+  // one level of the mip chain, at offset bytes in the pixels or the external storage
+  struct mip_level {
+    std::size_t offset;
+    std::size_t bytes;
+    std::size_t width;
+    std::size_t height;
+  };
+
   pixel_data()
    :pixels()
    ,width{0}
@@ -18,19 +28,41 @@ struct pixel_data {
    ,depth{0}
    ,channels{GL_NONE}
    ,channel_type{GL_NONE}
+   ,compression{GL_NONE}
+   ,levels{}
+   ,storage{}
   {}
 
   pixel_data(std::vector<std::uint8_t> dat, GLenum c, GLenum ty, std::size_t w, std::size_t h = 1, std::size_t d = 1)
-   :pixels(dat)
+   :pixels(std::move(dat))
+   ,width{w}
+   ,height{h}
+   ,depth{d}
+   ,channels{c}
+   ,channel_type{ty}
+   ,compression{GL_NONE}
+   ,levels{mip_level{0, pixels.size(), w, h}}
+   ,storage{}
+  {}
+
+  // base level of bytes in external storage, which is shared instead of copied
+  pixel_data(std::shared_ptr<std::uint8_t const> dat, std::size_t bytes, GLenum c, GLenum ty, std::size_t w, std::size_t h = 1, std::size_t d = 1)
+   :pixels()
    ,width{w}
    ,height{h}
    ,depth{d}
    ,channels{c}
    ,channel_type{ty}
+   ,compression{GL_NONE}
+   ,levels{mip_level{0, bytes, w, h}}
+   ,storage(std::move(dat))
   {}
 
-  void const* ptr() const {
-    return pixels.data();
+  // texels of a mip level, from the pixels or the external storage
+  void const* ptr(std::size_t level = 0) const;
+  // number of mip levels, at least the base level
+  std::size_t level_num() const {
+    return levels.empty() ? 1 : levels.size();
   }
 
   std::vector<std::uint8_t> pixels;
@@ -42,6 +74,14 @@ struct pixel_data {
   GLenum channels; 
   // pixel format
   GLenum channel_type; 
+  // gl internal format of compressed blocks replacing the texels, GL_NONE if uncompressed
+  GLenum compression;
+
+  // mip chain starting with the base level
+  std::vector<mip_level> levels;
+  // external storage used instead of the pixels, e.g. decoder memory or a memory-mapped cache file,
+  // released by the deleter of its owner
+  std::shared_ptr<std::uint8_t const> storage;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+#include <glbinding/gl/types.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// binary cache of linked shader programs, keyed by a hash of their sources and the driver.
+// files are stored in a cache directory next to the first shader
+namespace program_cache {
+  // whether the context can retrieve and load program binaries
+  bool supported();
+  // hash of the shader sources and the gl implementation, binaries are only valid for the same hash
+  std::uint64_t source_hash(std::vector<std::string> const& sources);
+  // path of the cache file for a program made of the shaders, preprocessed with the defines
+  std::string file_path(std::vector<std::string> const& shader_paths, std::vector<std::string> const& defines);
+  // create program from cached binary, returns 0 if no cache exists, it is outdated or the driver rejects
+  // the binary format. build_time is set to the milliseconds the cached program took to compile and link
+  GLuint load(std::string const& cache_path, std::uint64_t hash, double& build_time);
+  // write binary of a program linked with retrievable hint, returns false if it could not be written
+  bool store(std::string const& cache_path, std::uint64_t hash, GLuint program, double build_time);
+};
+
+#endif
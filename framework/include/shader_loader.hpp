@@ -4,15 +4,64 @@
 #include <glbinding/gl/enum.h>
 using namespace gl;
 
+#include <cstddef>
+#include <cstdint>
+#include <map>
 #include <string>
+#include <vector>
 
 namespace shader_loader {
+  // use of the program cache since start
+  struct cache_statistics {
+    std::size_t hits;
+    std::size_t misses;
+    // milliseconds of compiling and linking saved by hits
+    double saved_time;
+  };
+
+  // program compiled and linked in the background, completed by finish_program or discarded by cancel_program
+  struct program_build {
+    std::vector<std::string> paths;
+    // shader file names for the logs, with the source string numbers of their included files
+    std::vector<std::string> names;
+    // shader and included files
+    std::vector<std::string> files;
+    // shaders being compiled, empty if the program was loaded from the cache
+    std::vector<unsigned> shaders;
+    unsigned program;
+    // program cache entry written when finished
+    bool cached;
+    std::uint64_t hash;
+    std::string cache_path;
+    // milliseconds spent in the compile, link and status calls, not the frames between them
+    double build_time;
+  };
+
+  // source of the shader with the included files inserted once, where '#include "file"' names them relative
+  // to the including file, and the defines after the version directive. a define is a name or 'name=value'.
+  // line directives number the included files as source strings in the order they are appended to files
+  std::string preprocess(std::string const& file_path, std::vector<std::string> const& defines, std::vector<std::string>& files);
   // compile shader
   unsigned shader(std::string const& file_path, GLenum shader_type);
-  // create program from vertex and fragment shader
+  // create program from vertex and fragment shader, from a cached binary if the sources did not change
   unsigned program(std::string const& vertex_name, std::string const& fragment_name);
   // create program from vertex, geometry and fragment shader
   unsigned program(std::string const& vertex_path, std::string const& geometry_path, std::string const& fragment_path);
+  cache_statistics const& cache_stats();
+  // locations of the active uniforms of a linked program, arrays are named without subscript.
+  // uniforms in blocks have no location and are left out
+  std::map<std::string, int> uniform_locations(unsigned program);
+
+  // start building a program from shaders of the given types, each preprocessed with the defines. compiling and linking only runs in the
+  // background with parallel shader compile support, otherwise finishing the build blocks until they are done
+  program_build build_program(std::vector<std::string> const& paths, std::vector<GLenum> const& types,
+                              std::vector<std::string> const& defines = std::vector<std::string>{});
+  // whether finishing the build would not block
+  bool program_ready(program_build const& build);
+  // check compilation and linking and return the program, throws exception if either was unsuccessfull
+  unsigned finish_program(program_build& build);
+  // free the objects of an unfinished build
+  void cancel_program(program_build& build);
 };
 
 #endif
@@ -0,0 +1,146 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+// minimal float vector type, uses the widest instruction set enabled at compile time
+#if defined(__AVX__)
+  #include <immintrin.h>
+  #define SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define SIMD_SSE
+#endif
+
+#include <cmath>
+#include <cstddef>
+
+namespace simd {
+
+#if defined(SIMD_AVX)
+  typedef __m256 floats;
+  std::size_t const WIDTH = 8;
+
+  inline floats load(float const* ptr) { return _mm256_loadu_ps(ptr); }
+  inline void store(float* ptr, floats a) { _mm256_storeu_ps(ptr, a); }
+  inline floats set(float value) { return _mm256_set1_ps(value); }
+  inline floats add(floats a, floats b) { return _mm256_add_ps(a, b); }
+  inline floats sub(floats a, floats b) { return _mm256_sub_ps(a, b); }
+  inline floats mul(floats a, floats b) { return _mm256_mul_ps(a, b); }
+  inline floats min(floats a, floats b) { return _mm256_min_ps(a, b); }
+  inline floats max(floats a, floats b) { return _mm256_max_ps(a, b); }
+  inline floats sqrt(floats a) { return _mm256_sqrt_ps(a); }
+  // 1 / a, 0 where a is 0
+  inline floats reciprocal_or_zero(floats a) {
+    floats nonzero = _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_NEQ_OQ);
+    return _mm256_and_ps(nonzero, _mm256_div_ps(_mm256_set1_ps(1.0f), a));
+  }
+#elif defined(SIMD_SSE)
+  typedef __m128 floats;
+  std::size_t const WIDTH = 4;
+
+  inline floats load(float const* ptr) { return _mm_loadu_ps(ptr); }
+  inline void store(float* ptr, floats a) { _mm_storeu_ps(ptr, a); }
+  inline floats set(float value) { return _mm_set1_ps(value); }
+  inline floats add(floats a, floats b) { return _mm_add_ps(a, b); }
+  inline floats sub(floats a, floats b) { return _mm_sub_ps(a, b); }
+  inline floats mul(floats a, floats b) { return _mm_mul_ps(a, b); }
+  inline floats min(floats a, floats b) { return _mm_min_ps(a, b); }
+  inline floats max(floats a, floats b) { return _mm_max_ps(a, b); }
+  inline floats sqrt(floats a) { return _mm_sqrt_ps(a); }
+  // 1 / a, 0 where a is 0
+  inline floats reciprocal_or_zero(floats a) {
+    floats nonzero = _mm_cmpneq_ps(a, _mm_setzero_ps());
+    return _mm_and_ps(nonzero, _mm_div_ps(_mm_set1_ps(1.0f), a));
+  }
+#else
+  // scalar fallback
+  typedef float floats;
+  std::size_t const WIDTH = 1;
+
+  inline floats load(float const* ptr) { return *ptr; }
+  inline void store(float* ptr, floats a) { *ptr = a; }
+  inline floats set(float value) { return value; }
+  inline floats add(floats a, floats b) { return a + b; }
+  inline floats sub(floats a, floats b) { return a - b; }
+  inline floats mul(floats a, floats b) { return a * b; }
+  inline floats min(floats a, floats b) { return a < b ? a : b; }
+  inline floats max(floats a, floats b) { return a > b ? a : b; }
+  inline floats sqrt(floats a) { return std::sqrt(a); }
+  // 1 / a, 0 where a is 0
+  inline floats reciprocal_or_zero(floats a) { return a != 0.0f ? 1.0f / a : 0.0f; }
+#endif
+
+  // a * b + c
+  inline floats mul_add(floats a, floats b, floats c) { return add(mul(a, b), c); }
+
+  // vector of 4 lanes independent of WIDTH, e.g. one rgba texel
+#if defined(SIMD_AVX) || defined(SIMD_SSE)
+  typedef __m128 float4;
+
+  inline float4 load4(float const* ptr) { return _mm_loadu_ps(ptr); }
+  inline void store4(float* ptr, float4 a) { _mm_storeu_ps(ptr, a); }
+  inline float4 set4(float value) { return _mm_set1_ps(value); }
+  inline float4 add4(float4 a, float4 b) { return _mm_add_ps(a, b); }
+  inline float4 mul4(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+  // sums of the lane pairs of a and b, {a0 + a2, a1 + a3, b0 + b2, b1 + b3}
+  inline float4 pair_sum4(float4 a, float4 b) { return _mm_add_ps(_mm_movelh_ps(a, b), _mm_movehl_ps(b, a)); }
+#else
+  struct float4 {
+    float v[4];
+  };
+
+  inline float4 load4(float const* ptr) { return float4{{ptr[0], ptr[1], ptr[2], ptr[3]}}; }
+  inline void store4(float* ptr, float4 a) { ptr[0] = a.v[0]; ptr[1] = a.v[1]; ptr[2] = a.v[2]; ptr[3] = a.v[3]; }
+  inline float4 set4(float value) { return float4{{value, value, value, value}}; }
+  inline float4 add4(float4 a, float4 b) { return float4{{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+  inline float4 mul4(float4 a, float4 b) { return float4{{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+  // sums of the lane pairs of a and b, {a0 + a2, a1 + a3, b0 + b2, b1 + b3}
+  inline float4 pair_sum4(float4 a, float4 b) { return float4{{a.v[0] + a.v[2], a.v[1] + a.v[3], b.v[0] + b.v[2], b.v[1] + b.v[3]}}; }
+#endif
+
+#if defined(SIMD_AVX) || defined(SIMD_SSE)
+  // load 4 xyz triples as vectors of their components, read as x0 y0 z0 x1, y1 z1 x2 y2, z2 x3 y3 z3
+  inline void load3x4(float const* ptr, float4& x, float4& y, float4& z) {
+    float4 a = _mm_loadu_ps(ptr);
+    float4 b = _mm_loadu_ps(ptr + 4);
+    float4 c = _mm_loadu_ps(ptr + 8);
+    x = _mm_shuffle_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 0, 0)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+    y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+  }
+  // store vectors of x, y and z components as 4 xyz triples
+  inline void store3x4(float* ptr, float4 x, float4 y, float4 z) {
+    _mm_storeu_ps(ptr, _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(ptr + 4, _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(ptr + 8, _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+  }
+#endif
+
+#if defined(SIMD_AVX)
+  // load WIDTH xyz triples from ptr as vectors of their x, y and z components
+  inline void load3(float const* ptr, floats& x, floats& y, floats& z) {
+    float4 x0, y0, z0, x1, y1, z1;
+    load3x4(ptr, x0, y0, z0);
+    load3x4(ptr + 12, x1, y1, z1);
+    x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+    y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+    z = _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1);
+  }
+  // store vectors of x, y and z components as WIDTH xyz triples to ptr
+  inline void store3(float* ptr, floats x, floats y, floats z) {
+    store3x4(ptr, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z));
+    store3x4(ptr + 12, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1));
+  }
+#elif defined(SIMD_SSE)
+  // load WIDTH xyz triples from ptr as vectors of their x, y and z components
+  inline void load3(float const* ptr, floats& x, floats& y, floats& z) { load3x4(ptr, x, y, z); }
+  // store vectors of x, y and z components as WIDTH xyz triples to ptr
+  inline void store3(float* ptr, floats x, floats y, floats z) { store3x4(ptr, x, y, z); }
+#else
+  // load WIDTH xyz triples from ptr as vectors of their x, y and z components
+  inline void load3(float const* ptr, floats& x, floats& y, floats& z) { x = ptr[0]; y = ptr[1]; z = ptr[2]; }
+  // store vectors of x, y and z components as WIDTH xyz triples to ptr
+  inline void store3(float* ptr, floats x, floats y, floats z) { ptr[0] = x; ptr[1] = y; ptr[2] = z; }
+#endif
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 #include <string>
+#include <vector>
 
 // use gl definitions from glbinding
 using namespace gl;
@@ -29,6 +30,8 @@ struct model_object {
   GLenum draw_mode = GL_NONE;
   // indices number, if EBO exists
   GLsizei num_elements = 0;
+  // type of indices in EBO
+  GLenum index_type = GL_UNSIGNED_INT;
 };
 
 // gpu representation of texture
@@ -60,16 +63,22 @@ struct shader_program {
   // path to shader source
   std::string vertex_path;
   std::string fragment_path;
+  // defines the shaders are preprocessed with
+  std::vector<std::string> defines{};
+  // shader and included files of the last build
+  std::vector<std::string> files{};
   // object handle
   GLuint handle;
-  // uniform locations mapped to name
+  // uniform locations mapped to name, the active uniforms are added when the program is built
   std::map<std::string, GLint> u_locs{};
+  // uniform locations indexed by the uniform ids of the application, -1 if the uniform is not active
+  std::vector<GLint> u_handles{};
 };
 
 struct planet {
   planet(std::string const& name, float size, float rotation_speed, float self_rotation_speed,
         float distance_to_origin, std::string const& orbit_origin,
-        Planet_Type const& type, glm::vec3 const& color, int texture_index, int normal_index) :
+        Planet_Type const& type, glm::vec3 const& color, int texture_layer, int normal_index) :
     m_name {name},
     m_size {float(size * 0.01f)},
     m_rotation_speed {float(rotation_speed * 0.0005f)},
@@ -78,7 +87,7 @@ struct planet {
     m_orbit_origin {orbit_origin},
     m_planet_type {type},
     m_planet_color {color},
-    m_texture_index {texture_index},
+    m_texture_layer {texture_layer},
     m_normal_index {normal_index} {}
 
   std::string m_name;
@@ -89,7 +98,7 @@ struct planet {
   std::string m_orbit_origin; // orbit planet
   Planet_Type m_planet_type;  // type of planet (_moon, _sun, _planet)
   glm::vec3 m_planet_color;
-  int m_texture_index;        // set planet texture index
+  int m_texture_layer;        // layer in the planet texture array
   int m_normal_index;
 };
 
@@ -0,0 +1,28 @@
+#ifndef TEXTURE_ARRAY_HPP
+#define TEXTURE_ARRAY_HPP
+
+#include "pixel_data.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <vector>
+
+// packing of 2d textures into the layers of one array texture, so draws do not need to rebind textures
+namespace texture_array {
+  // position of a packed texture
+  struct layer {
+    std::size_t index;
+    // texcoords are multiplied with the scale, smaller textures only cover a part of their layer.
+    // the scale is exact for the base level only: chains of sizes other than powers of two round down
+    // (2000 wide gives 62 where the layer has 64), so lower levels sample up to a few texels into the
+    // padding. the padding repeats the border, which is accepted instead of padding sources before filtering
+    glm::fvec2 texcoord_scale;
+  };
+
+  // one layer per image with the size of the largest image and its mip chain. smaller images are placed
+  // in the corner and padded by repeating their border, compressed ones by repeating their border blocks.
+  // all images need the same format, layers are filled in the order of the images
+  pixel_data pack(std::vector<pixel_data const*> const& images, std::vector<layer>& layers);
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+#include "pixel_data.hpp"
+
+#include <string>
+
+// binary cache of decoded textures with their mip chain, memory-mapped on load
+// so levels can be uploaded directly from the file.
+// variant names the processing of the source, each variant has its own cache file
+namespace texture_cache {
+  // path of the cache file for a source image
+  std::string file_path(std::string const& source_path, std::string const& variant);
+  // map cached texture, returns false if no cache exists or it is outdated
+  bool load(std::string const& source_path, std::string const& variant, pixel_data& result);
+  // write texture to cache, returns false if the cache file could not be written
+  bool store(std::string const& source_path, std::string const& variant, pixel_data const& source);
+};
+
+#endif
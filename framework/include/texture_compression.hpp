@@ -0,0 +1,35 @@
+#ifndef TEXTURE_COMPRESSION_HPP
+#define TEXTURE_COMPRESSION_HPP
+
+#include "pixel_data.hpp"
+
+#include <string>
+
+// block compression of 4x4 texel blocks on the cpu, encoded in parallel on the global thread pool.
+// missing channels are filled like gl does, with 0 for color and 255 for alpha
+namespace texture_compression {
+  enum format {
+    NONE,
+    // rgb with 4 bits per texel, alpha is dropped
+    BC1,
+    // rgba with 8 bits per texel, bc1 color and separate alpha
+    BC3,
+    // two independent channels with 8 bits per texel, for normal maps
+    BC5,
+    // rgba with 8 bits per texel, higher quality than bc1 and bc3
+    BC7
+  };
+
+  // gl internal format of the compressed texels, GL_NONE for uncompressed
+  GLenum internal_format(format target);
+  // bytes of one 4x4 block
+  std::size_t block_bytes(format target);
+  // lowercase name, e.g. for file names
+  std::string name(format target);
+
+  // replace every level of an unsigned byte image with its compressed blocks, layers are compressed
+  // separately. levels smaller than a block are padded by repeating the border
+  void compress(pixel_data& image, format target);
+};
+
+#endif
@@ -2,11 +2,44 @@
 #define TEXTURE_LOADER_HPP
 
 #include "pixel_data.hpp"
+#include "texture_compression.hpp"
 
 #include <string>
+#include <vector>
 
 namespace texture_loader {
-  pixel_data file(std::string const& file_name);
+  // processing of a texture after decoding
+  struct options {
+    options(bool s = true, texture_compression::format c = texture_compression::NONE, bool cube = false)
+     :srgb{s}
+     ,compression{c}
+     ,cube_map{cube}
+    {}
+    // color channels are srgb encoded, otherwise all channels are linear data like normals
+    bool srgb;
+    // block compression of all levels after mipmap generation
+    texture_compression::format compression;
+    // resample into six cube map faces with cube_faces instead of generating mipmaps
+    bool cube_map;
+  };
+
+  // image decoded with stb_image, only the base level and never cached
+  pixel_data decode(std::string const& file_name);
+  // decoded image with mip chain, mapped from the texture cache when it matches the file
+  pixel_data file(std::string const& file_name, options const& settings = options{});
+  // decode the files concurrently on the global thread pool, results are in the order of the names.
+  // settings are per file, missing ones are default. rethrows the first error after all decodes have finished
+  std::vector<pixel_data> files(std::vector<std::string> const& file_names, std::vector<options> const& settings = std::vector<options>{});
+
+  // replace the mip chain with box filtered levels down to 1x1, base level is kept.
+  // srgb color channels are filtered in linear space, alpha is always linear
+  void generate_mipmaps(pixel_data& image, bool srgb = true);
+  // resample an equirectangular (2:1) or horizontal cross (4:3) image into six square layers in the order
+  // of the cube map targets, face_size 0 keeps the resolution of the source. cross cells are +x right of
+  // the center, -x left, +y below, -y above, +z the center and -z rightmost, as in the skybox files.
+  // faces are filtered bilinearly in linear space, each face is a pool task unless called from a worker.
+  // files() and file() on a worker, as for the skybox, resample the faces serially beside the other decodes
+  pixel_data cube_faces(pixel_data const& image, bool srgb = true, std::size_t face_size = 0);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef TEXTURE_MANAGER_HPP
+#define TEXTURE_MANAGER_HPP
+
+#include "pixel_data.hpp"
+#include "structs.hpp"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+
+class texture_manager;
+
+// texture owned by a texture_manager, keeping its image to upload evicted levels again
+class managed_texture {
+ public:
+  // object for sampling, replaced when levels are evicted or uploaded again
+  texture_object const& object() const {
+    return m_object;
+  }
+  // finest mip level of the image on the gpu
+  std::size_t resident_level() const {
+    return m_resident_level;
+  }
+  // bytes of the levels on the gpu
+  std::size_t resident_bytes() const {
+    return m_resident_bytes;
+  }
+  pixel_data const& image() const {
+    return m_image;
+  }
+
+ private:
+  friend class texture_manager;
+
+  managed_texture(texture_manager* owner, pixel_data image);
+
+  texture_manager* m_owner;
+  pixel_data m_image;
+  texture_object m_object;
+  std::size_t m_resident_level;
+  std::size_t m_resident_bytes;
+  // frame of the last use
+  std::uint64_t m_frame;
+  std::list<managed_texture*>::iterator m_use;
+};
+
+// texture is deleted with the last copy of the handle
+typedef std::shared_ptr<managed_texture> texture_handle;
+
+// accounts the gpu memory of its textures and keeps it below a budget. when a texture needs more memory,
+// the least recently used textures not used in the current frame are reduced to their coarse levels,
+// they are uploaded in full again when used
+class texture_manager {
+ public:
+  // budget in bytes, evicted textures keep the levels with at most evicted_size texels per side
+  texture_manager(std::size_t budget, std::size_t evicted_size = 64);
+  // delete all textures, remaining handles are left without object
+  ~texture_manager();
+
+  texture_manager(texture_manager const&) = delete;
+  texture_manager& operator=(texture_manager const&) = delete;
+
+  // upload the image with its mip chain, generated if missing. array texture if it has several layers,
+  // needs a current gl context and binds the texture to the active unit
+  texture_handle create(pixel_data image);
+  // mark the texture as used in this frame and upload evicted levels again, binds the texture
+  // to the active unit if it is replaced
+  texture_object const& use(texture_handle const& texture);
+  // start a new frame, textures used in the previous one may be evicted
+  void next_frame();
+
+  void set_budget(std::size_t budget);
+  std::size_t budget() const {
+    return m_budget;
+  }
+  // bytes of all resident levels
+  std::size_t allocated() const {
+    return m_allocated;
+  }
+  std::size_t texture_num() const {
+    return m_textures.size();
+  }
+
+ private:
+  // deleter of the handles
+  static void release(managed_texture* texture);
+  // evict least recently used textures until bytes more fit into the budget
+  void make_room(std::size_t bytes);
+  // finest level kept by an evicted texture
+  std::size_t evicted_level(managed_texture const& texture) const;
+  // bytes of the levels starting at level
+  static std::size_t level_bytes(pixel_data const& image, std::size_t level);
+  // replace the texture object with one holding the levels starting at level
+  void upload(managed_texture& texture, std::size_t level);
+
+  std::size_t m_budget;
+  std::size_t m_evicted_size;
+  std::size_t m_allocated;
+  std::uint64_t m_frame;
+  // most recently used at the front
+  std::list<managed_texture*> m_textures;
+};
+
+#endif
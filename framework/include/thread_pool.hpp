@@ -0,0 +1,64 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// fixed number of worker threads executing queued tasks
+class thread_pool {
+ public:
+  // start workers, by default one per hardware thread
+  thread_pool(std::size_t num_threads = 0);
+  // finish queued tasks and join workers
+  ~thread_pool();
+
+  thread_pool(thread_pool const&) = delete;
+  thread_pool& operator=(thread_pool const&) = delete;
+
+  // queue task, future returns result or rethrows exception
+  template<typename F>
+  std::future<typename std::result_of<F()>::type> submit(F&& task) {
+    typedef typename std::result_of<F()>::type result_t;
+    // packaged task is move-only, std::function requires copyable
+    auto packaged = std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(task));
+    std::future<result_t> result = packaged->get_future();
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_tasks.emplace([packaged](){ (*packaged)(); });
+    }
+    m_condition.notify_one();
+    return result;
+  }
+
+  // number of worker threads
+  std::size_t size() const;
+
+  // process wide pool shared by the framework
+  static thread_pool& global();
+  // whether the calling thread is a pool worker
+  static bool in_worker();
+
+ private:
+  void work();
+
+  std::vector<std::thread> m_workers;
+  std::queue<std::function<void()>> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_stop;
+};
+
+// number of chunks parallel_for splits count elements into
+std::size_t parallel_chunks(std::size_t count, std::size_t min_chunk_size = 1);
+// call func(chunk, begin, end) for the chunks of [0, count) on the global pool and wait for completion,
+// runs serially when called from a worker to prevent deadlocks
+void parallel_for(std::size_t count, std::function<void(std::size_t, std::size_t, std::size_t)> const& func, std::size_t min_chunk_size = 1);
+
+#endif
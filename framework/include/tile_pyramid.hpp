@@ -0,0 +1,77 @@
+#ifndef TILE_PYRAMID_HPP
+#define TILE_PYRAMID_HPP
+
+#include "pixel_data.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class mapped_file;
+
+// mip chain of a texture split into square tiles, each surrounded by a border of its neighbour texels
+// so tiles can be filtered independently. the file is memory-mapped, so tiles are only read when used
+class tile_pyramid {
+ public:
+  // size of one mip level in texels and tiles
+  struct level {
+    std::size_t width;
+    std::size_t height;
+    std::size_t tiles_x;
+    std::size_t tiles_y;
+    // index of the first tile of the level in the file
+    std::size_t first_tile;
+  };
+
+  // map pyramid file, throwing exception if it can not be opened or is invalid
+  tile_pyramid(std::string const& path);
+  ~tile_pyramid();
+
+  tile_pyramid(tile_pyramid const&) = delete;
+  tile_pyramid& operator=(tile_pyramid const&) = delete;
+
+  // tile the mip chain of an unsigned byte image, down to the level which fits in one tile,
+  // and write it to path. tiles have tile_size texels plus border texels on every side,
+  // columns wrap around as in equirectangular maps and rows are clamped
+  static void write(pixel_data const& image, std::string const& path, std::size_t tile_size = 120, std::size_t border = 4);
+
+  // texels of the tile, rows of padded_size() texels, safe to call from any thread
+  std::uint8_t const* tile(std::size_t level_index, std::size_t x, std::size_t y) const;
+
+  std::vector<level> const& levels() const {
+    return m_levels;
+  }
+  // texels of a tile without border
+  std::size_t tile_size() const {
+    return m_tile_size;
+  }
+  std::size_t border() const {
+    return m_border;
+  }
+  // texels of a tile with border
+  std::size_t padded_size() const {
+    return m_tile_size + m_border * 2;
+  }
+  std::size_t tile_bytes() const {
+    return m_tile_bytes;
+  }
+  GLenum channels() const {
+    return m_channels;
+  }
+  GLenum channel_type() const {
+    return m_channel_type;
+  }
+
+ private:
+  std::unique_ptr<mapped_file> m_file;
+  std::vector<level> m_levels;
+  std::size_t m_tile_size;
+  std::size_t m_border;
+  std::size_t m_tile_bytes;
+  std::uint64_t m_data_offset;
+  GLenum m_channels;
+  GLenum m_channel_type;
+};
+
+#endif
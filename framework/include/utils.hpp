@@ -7,10 +7,19 @@ using namespace gl;
 
 struct pixel_data;
 struct texture_object;
+struct model;
 
 namespace utils {
-  // generate texture object from texture struct
+  // generate texture object from texture struct, an array texture if it has several layers
   texture_object create_texture_object(pixel_data const& tex);
+  // generate cube map from the six layers of the texture, in the order of the cube map targets
+  texture_object create_cube_map_object(pixel_data const& faces);
+  // specify a level of the texture bound to target, e.g. a cube map face or all layers of an array,
+  // compressed blocks are uploaded directly. the level is specified at level - base_level, so a chain
+  // can be uploaded without its finest levels
+  void tex_image(GLenum target, pixel_data const& tex, std::size_t level = 0, std::size_t base_level = 0);
+  // whether the current context can sample the compressed internal format, GL_NONE is always supported
+  bool supports_compression(GLenum internal_format);
   // print bound textures for all texture units
   void print_bound_textures();
 
@@ -22,6 +31,8 @@ namespace utils {
 
   // return handle of bound vertex array object
   GLint get_bound_VAO();
+  // point vertex attribute location to attribute of model in bound array buffer, using its type and layout
+  void vertex_attrib_pointer(GLuint location, model const& source, int attribute);
 
   // extract filename from path
   std::string file_name(std::string const& file_path);
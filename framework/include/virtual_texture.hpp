@@ -0,0 +1,111 @@
+#ifndef VIRTUAL_TEXTURE_HPP
+#define VIRTUAL_TEXTURE_HPP
+
+#include "structs.hpp"
+#include "tile_pyramid.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// texture of any size with a fixed memory footprint. tiles of a tile_pyramid are streamed on a background thread
+// into the pages of a physical cache texture, least recently used tiles are replaced. an indirection array texture
+// holds per level and tile the page and level of the finest resident tile covering it, the coarsest level is always resident
+class virtual_texture {
+ public:
+  // cache of pages_per_side squared tiles, needs a current gl context
+  virtual_texture(std::string const& pyramid_path, std::size_t pages_per_side = 16);
+  // stop streaming and delete the textures
+  ~virtual_texture();
+
+  virtual_texture(virtual_texture const&) = delete;
+  virtual_texture& operator=(virtual_texture const&) = delete;
+
+  // mark tile as used in this frame, it is streamed in if not resident
+  void request(std::size_t level, std::size_t x, std::size_t y);
+  // request the tiles of an equirectangular texture on the unit sphere transformed by model_matrix, as used by
+  // model_generator. tiles in front of the horizon are refined from coarse to fine while their texels cover more
+  // than a pixel, until the cache is full. pixels_per_unit is the size of a unit at unit distance on screen
+  void request_sphere(glm::fmat4 const& model_matrix, glm::fvec3 const& camera_position, float pixels_per_unit);
+  // upload up to max_uploads streamed tiles, update the indirection and queue the missing tiles requested
+  // since the last update. call once per frame with the gl context current
+  void update(std::size_t max_uploads = 32);
+
+  // pages of padded tiles
+  texture_object const& cache() const {
+    return m_cache;
+  }
+  // rgba8ui texel per tile with layers per level, holding page x, page y and level of the resident tile
+  texture_object const& indirection() const {
+    return m_indirection;
+  }
+  tile_pyramid const& pyramid() const {
+    return m_pyramid;
+  }
+  // texels per side of the cache
+  std::size_t cache_size() const {
+    return m_pages_per_side * m_pyramid.padded_size();
+  }
+  // number of tiles in the cache
+  std::size_t resident_num() const {
+    return m_resident.size();
+  }
+
+ private:
+  struct resident_tile {
+    std::size_t page;
+    // position in the lru list, pinned tiles are not in the list
+    std::list<std::size_t>::iterator use;
+    bool pinned;
+    // frame of the last request
+    std::uint64_t frame;
+  };
+
+  struct loaded_tile {
+    std::size_t id;
+    std::vector<std::uint8_t> texels;
+  };
+
+  // tile id is its index in the pyramid file
+  std::size_t tile_id(std::size_t level, std::size_t x, std::size_t y) const;
+  void tile_position(std::size_t id, std::size_t& level, std::size_t& x, std::size_t& y) const;
+  void upload(std::size_t page, std::uint8_t const* texels);
+  // page of a free slot or the least recently used tile not requested in this frame, false if all are in use
+  bool allocate_page(std::size_t& page);
+  void update_indirection();
+  void stream();
+
+  tile_pyramid m_pyramid;
+  std::size_t m_pages_per_side;
+  texture_object m_cache;
+  texture_object m_indirection;
+  std::vector<std::uint8_t> m_indirection_texels;
+
+  std::unordered_map<std::size_t, resident_tile> m_resident;
+  // most recently used at the front
+  std::list<std::size_t> m_lru;
+  std::vector<std::size_t> m_free_pages;
+  std::vector<std::size_t> m_requested;
+  std::uint64_t m_frame;
+
+  // shared with the streaming thread
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<std::size_t> m_queue;
+  std::vector<loaded_tile> m_loaded;
+  // tiles queued or being read
+  std::unordered_set<std::size_t> m_pending;
+  bool m_stop;
+  std::thread m_streamer;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "application.hpp"
 #include "utils.hpp"
+#include "shader_loader.hpp"
 
 #include <glbinding/gl/gl.h>
 // use gl definitions from glbinding 
@@ -24,6 +25,10 @@ Application::~Application() {
   }
 }
 
+gl_state const& Application::getGlState() const {
+  return m_gl_state;
+}
+
 void Application::setProjection(glm::fmat4 const& projection_mat) {
   m_view_projection = projection_mat;
   updateProjection();
@@ -32,11 +37,69 @@ void Application::setProjection(glm::fmat4 const& projection_mat) {
 // update shader uniform locations
 void Application::updateUniformLocations() {
   for (auto& pair : m_shaders) {
-    for (auto& uniform : pair.second.u_locs) {
-      // store uniform location in map
-      uniform.second = utils::glGetUniformLocation(pair.second.handle, uniform.first.c_str());
+    updateUniformLocations(pair.second);
+  }
+}
+
+void Application::updateUniformLocations(shader_program& program) {
+  // requested uniforms which are not active keep an invalid location
+  for (auto& uniform : program.u_locs) {
+    uniform.second = -1;
+  }
+  // store locations of all active uniforms in map
+  for (auto const& uniform : shader_loader::uniform_locations(program.handle)) {
+    program.u_locs[uniform.first] = uniform.second;
+  }
+  // glsl 1.50 can not declare the binding point of a block
+  for (auto const& block : m_uniform_blocks) {
+    GLuint index = glGetUniformBlockIndex(program.handle, block.first.c_str());
+    if (index != GL_INVALID_INDEX) {
+      glUniformBlockBinding(program.handle, index, block.second);
+    }
+  }
+  // resolve the handles once, so drawing needs no name lookups
+  program.u_handles.assign(m_uniform_names.size(), -1);
+  for (std::size_t id = 0; id < m_uniform_names.size(); ++id) {
+    auto uniform = program.u_locs.find(m_uniform_names[id]);
+    if (uniform != program.u_locs.end()) {
+      program.u_handles[id] = uniform->second;
+    }
+  }
+}
+
+std::string Application::addProgramVariant(std::string const& name, std::vector<std::string> const& defines) {
+  std::string variant{name};
+  for (auto const& define : defines) {
+    variant += "." + define;
+  }
+  if (m_shaders.find(variant) == m_shaders.end()) {
+    shader_program program{m_shaders.at(name).vertex_path, m_shaders.at(name).fragment_path};
+    program.defines = defines;
+    m_shaders.emplace(variant, program);
+  }
+  return variant;
+}
+
+std::string Application::programVariant(std::string const& name, std::vector<std::string> const& defines) {
+  std::string variant{addProgramVariant(name, defines)};
+  shader_program& program = m_shaders.at(variant);
+  if (program.handle == 0) {
+    shader_loader::program_build build{shader_loader::build_program({program.vertex_path, program.fragment_path},
+                                                                    {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER},
+                                                                    defines)};
+    try {
+      // throws exception when compiling was unsuccessfull
+      program.handle = shader_loader::finish_program(build);
+    }
+    catch (std::exception&) {
+      // a failed variant is not kept, so it is tried again when requested
+      m_shaders.erase(variant);
+      throw;
     }
+    program.files = build.files;
+    uploadProgramUniforms(variant);
   }
+  return variant;
 }
 
 std::map<std::string, shader_program>& Application::getShaderPrograms() {
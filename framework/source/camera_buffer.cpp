@@ -0,0 +1,51 @@
+#include "camera_buffer.hpp"
+
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+
+#include <glm/matrix.hpp>
+
+GLuint const camera_buffer::BINDING;
+char const* const camera_buffer::BLOCK = "Camera";
+
+camera_buffer::camera_buffer()
+ :m_block{}
+ ,m_buffer{0}
+ ,m_changed{true}
+{
+  glGenBuffers(1, &m_buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(block), nullptr, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  // the binding point is shared by all programs, so it is never changed
+  glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, m_buffer);
+}
+
+camera_buffer::~camera_buffer() {
+  glDeleteBuffers(1, &m_buffer);
+}
+
+void camera_buffer::set_view(glm::fmat4 const& view) {
+  m_block.view = view;
+  m_changed = true;
+}
+
+void camera_buffer::set_projection(glm::fmat4 const& projection) {
+  m_block.projection = projection;
+  m_changed = true;
+}
+
+void camera_buffer::upload() {
+  if (!m_changed) {
+    return;
+  }
+  m_block.view_projection = m_block.projection * m_block.view;
+  m_block.inverse_view = glm::inverse(m_block.view);
+  m_block.inverse_projection = glm::inverse(m_block.projection);
+  m_block.inverse_view_projection = glm::inverse(m_block.view_projection);
+
+  glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &m_block);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  m_changed = false;
+}
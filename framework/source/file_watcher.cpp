@@ -0,0 +1,105 @@
+#include "file_watcher.hpp"
+
+#ifdef __linux__
+  #include <sys/inotify.h>
+  #include <unistd.h>
+#endif
+#include <sys/stat.h>
+
+#include <set>
+#include <stdexcept>
+
+#ifdef __linux__
+
+file_watcher::file_watcher()
+ :m_inotify{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)}
+ ,m_files{}
+{
+  if (m_inotify < 0) {
+    throw std::runtime_error("Could not create inotify instance");
+  }
+}
+
+file_watcher::~file_watcher() {
+  close(m_inotify);
+}
+
+void file_watcher::watch(std::string const& file_path) {
+  // editors often replace files instead of writing them, so the directory is watched
+  std::size_t separator = file_path.find_last_of("/");
+  std::string directory{separator == std::string::npos ? "." : file_path.substr(0, separator + 1)};
+  std::string name{separator == std::string::npos ? file_path : file_path.substr(separator + 1)};
+
+  // watching a directory again returns the same descriptor
+  int watch = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (watch < 0) {
+    throw std::runtime_error("Could not watch \'" + file_path + "\'");
+  }
+  m_files[watch][name] = file_path;
+}
+
+std::vector<std::string> file_watcher::changed() {
+  std::set<std::string> changed_files{};
+  alignas(inotify_event) char buffer[4096];
+  ssize_t length = 0;
+  // queue is non-blocking, read fails when it is empty
+  while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0) {
+    for (char* event_ptr = buffer; event_ptr < buffer + length; ) {
+      inotify_event const* event = reinterpret_cast<inotify_event const*>(event_ptr);
+      event_ptr += sizeof(inotify_event) + event->len;
+      // events were dropped, any file may have changed
+      if (event->mask & IN_Q_OVERFLOW) {
+        for (auto const& directory : m_files) {
+          for (auto const& file : directory.second) {
+            changed_files.insert(file.second);
+          }
+        }
+        continue;
+      }
+      auto directory = m_files.find(event->wd);
+      if (directory == m_files.end() || event->len == 0) {
+        continue;
+      }
+      auto file = directory->second.find(event->name);
+      if (file != directory->second.end()) {
+        changed_files.insert(file->second);
+      }
+    }
+  }
+  return std::vector<std::string>{changed_files.begin(), changed_files.end()};
+}
+
+#else
+
+// last modification time, 0 if the file does not exist
+static std::time_t modification_time(std::string const& file_path) {
+  struct stat file_stat;
+  if (stat(file_path.c_str(), &file_stat) != 0) {
+    return 0;
+  }
+  return file_stat.st_mtime;
+}
+
+file_watcher::file_watcher()
+ :m_files{}
+{}
+
+file_watcher::~file_watcher() {}
+
+void file_watcher::watch(std::string const& file_path) {
+  m_files.emplace(file_path, modification_time(file_path));
+}
+
+std::vector<std::string> file_watcher::changed() {
+  std::vector<std::string> changed_files{};
+  for (auto& file : m_files) {
+    std::time_t time = modification_time(file.first);
+    if (time != file.second) {
+      file.second = time;
+      changed_files.push_back(file.first);
+    }
+  }
+  return changed_files;
+}
+
+#endif
@@ -0,0 +1,122 @@
+#include "gl_state.hpp"
+
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+#include <glbinding/gl/boolean.h>
+
+std::size_t const gl_state::UNIT_NUM;
+GLuint const gl_state::UNKNOWN;
+
+gl_state::gl_state()
+ :m_program{UNKNOWN}
+ ,m_vertex_array{UNKNOWN}
+ ,m_framebuffer{UNKNOWN}
+ ,m_active_unit{UNKNOWN}
+ ,m_textures{}
+ ,m_depth_mask{UNKNOWN}
+ ,m_depth_test{UNKNOWN}
+ ,m_issued{0}
+ ,m_filtered{0}
+{
+  invalidate_textures();
+}
+
+void gl_state::use_program(GLuint program) {
+  if (changes(m_program, program)) {
+    glUseProgram(program);
+  }
+}
+
+void gl_state::bind_vertex_array(GLuint vertex_array) {
+  if (changes(m_vertex_array, vertex_array)) {
+    glBindVertexArray(vertex_array);
+  }
+}
+
+void gl_state::bind_framebuffer(GLuint framebuffer) {
+  if (changes(m_framebuffer, framebuffer)) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  }
+}
+
+void gl_state::bind_texture(GLuint unit, GLenum target, GLuint texture) {
+  std::size_t index = slot(target);
+  if (unit < UNIT_NUM && index < TARGET_NUM) {
+    if (!changes(m_textures[unit][index], texture)) {
+      return;
+    }
+  }
+  else {
+    ++m_issued;
+  }
+  if (changes(m_active_unit, unit)) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+  }
+  glBindTexture(target, texture);
+}
+
+void gl_state::depth_mask(bool write) {
+  if (changes(m_depth_mask, write)) {
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+  }
+}
+
+void gl_state::depth_test(bool enable) {
+  if (changes(m_depth_test, enable)) {
+    if (enable) {
+      glEnable(GL_DEPTH_TEST);
+    }
+    else {
+      glDisable(GL_DEPTH_TEST);
+    }
+  }
+}
+
+void gl_state::invalidate() {
+  m_program = UNKNOWN;
+  m_vertex_array = UNKNOWN;
+  m_framebuffer = UNKNOWN;
+  m_active_unit = UNKNOWN;
+  m_depth_mask = UNKNOWN;
+  m_depth_test = UNKNOWN;
+  invalidate_textures();
+}
+
+void gl_state::invalidate_textures() {
+  for (auto& unit : m_textures) {
+    unit.fill(UNKNOWN);
+  }
+  // other code binds to whichever unit is active
+  m_active_unit = UNKNOWN;
+}
+
+std::size_t gl_state::issued() const {
+  return m_issued;
+}
+
+std::size_t gl_state::filtered() const {
+  return m_filtered;
+}
+
+bool gl_state::changes(GLuint& current, GLuint value) {
+  if (current == value) {
+    ++m_filtered;
+    return false;
+  }
+  current = value;
+  ++m_issued;
+  return true;
+}
+
+std::size_t gl_state::slot(GLenum target) {
+  switch (target) {
+    case GL_TEXTURE_2D:
+      return TEXTURE_2D;
+    case GL_TEXTURE_2D_ARRAY:
+      return TEXTURE_2D_ARRAY;
+    case GL_TEXTURE_CUBE_MAP:
+      return TEXTURE_CUBE_MAP;
+    default:
+      return TARGET_NUM;
+  }
+}
@@ -5,6 +5,8 @@
 #include <glbinding/Binding.h>
 // load meta info extension
 #include <glbinding/Meta.h>
+#include <glbinding/ContextInfo.h>
+#include <glbinding/Version.h>
 
 //dont load gl bindings from glfw
 #define GLFW_INCLUDE_NONE
@@ -18,6 +20,7 @@
 #include "utils.hpp"
 #include "shader_loader.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <functional>
 #include <iostream>
@@ -25,6 +28,12 @@
 // use gl definitions from glbinding
 using namespace gl;
 
+// gl error checking, set by cmake: 0 checks nothing, 1 reports errors asynchronously through
+// debug output if available, 2 calls glGetError after each gl call and throws at the failing one
+#ifndef GL_ERROR_CHECKS
+  #define GL_ERROR_CHECKS 1
+#endif
+
 // helper functions
 std::string resourcePath(int argc, char* argv[]);
 void glsl_error(int error, const char* description);
@@ -39,8 +48,11 @@ Launcher::Launcher(int argc, char* argv[])
  ,m_window{nullptr}
  ,m_last_second_time{0.0}
  ,m_frames_per_second{0u}
+ ,m_filtered_calls{0}
  ,m_resource_path{resourcePath(argc, argv)}
  ,m_application{}
+ ,m_shader_watcher{}
+ ,m_program_builds{}
 {}
 
 std::string resourcePath(int argc, char* argv[]) {
@@ -77,6 +89,10 @@ void Launcher::initialize() {
   #else
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_COMPAT_PROFILE);
   #endif
+#if GL_ERROR_CHECKS == 1
+  // drivers may only generate debug messages in debug contexts
+  glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, true);
+#endif
   // create m_window, if unsuccessfull, quit
   m_window = glfwCreateWindow(m_window_width, m_window_height, "OpenGL Framework", NULL, NULL);
   if (!m_window) {
@@ -111,7 +127,7 @@ void Launcher::initialize() {
   // initialize glindings in this context
   glbinding::Binding::initialize();
 
-  // activate error checking after each gl function call
+  // activate error checking of the configured strategy
   watch_gl_errors();
 }
 
@@ -119,6 +135,10 @@ void Launcher::mainLoop() {
   // do before framebuffer_resize call as it requires the projection uniform location
   // throw exception if shader compilation was unsuccessfull
   update_shader_programs(true);
+  shader_loader::cache_statistics const& stats = shader_loader::cache_stats();
+  std::cout << "Program cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+            << stats.saved_time << " ms saved" << std::endl;
+  watch_shader_programs();
 
   // enable depth testing
   glEnable(GL_DEPTH_TEST);
@@ -128,6 +148,8 @@ void Launcher::mainLoop() {
   while (!glfwWindowShouldClose(m_window)) {
     // query input
     glfwPollEvents();
+    // swap in programs with changed shaders
+    update_changed_programs();
     // clear buffer
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     // draw geometry
@@ -163,15 +185,31 @@ void Launcher::update_projection(GLFWwindow* m_window, int width, int height) {
 void Launcher::update_shader_programs(bool throwing) {
   // actual functionality in lambda to allow update with and without throwing
   auto update_lambda = [&](){
-    // reload all shader programs
-    for (auto& pair : m_application->getShaderPrograms()) {
-      // throws exception when compiling was unsuccessfull
-      GLuint new_program = shader_loader::program(pair.second.vertex_path,
-                                                  pair.second.fragment_path);
-      // free old shader program
-      glDeleteProgram(pair.second.handle);
-      // save new shader program
-      pair.second.handle = new_program;
+    // reload all shader programs, all are started before the first is finished so drivers
+    // with parallel shader compile build them concurrently
+    std::vector<std::pair<shader_program*, shader_loader::program_build>> builds{};
+    try {
+      for (auto& pair : m_application->getShaderPrograms()) {
+        builds.emplace_back(&pair.second, shader_loader::build_program({pair.second.vertex_path, pair.second.fragment_path},
+                                                                       {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER},
+                                                                       pair.second.defines));
+      }
+      for (auto& build : builds) {
+        // throws exception when compiling was unsuccessfull
+        GLuint new_program = shader_loader::finish_program(build.second);
+        build.first->files = build.second.files;
+        // free old shader program
+        glDeleteProgram(build.first->handle);
+        // save new shader program
+        build.first->handle = new_program;
+      }
+    }
+    catch (std::exception&) {
+      // finished and failed builds hold no objects any more
+      for (auto& build : builds) {
+        shader_loader::cancel_program(build.second);
+      }
+      throw;
     }
   };
 
@@ -196,6 +234,69 @@ void Launcher::update_shader_programs(bool throwing) {
   update_projection(m_window, width, height);
 }
 
+void Launcher::watch_shader_programs() {
+  for (auto const& pair : m_application->getShaderPrograms()) {
+    for (auto const& file : pair.second.files) {
+      m_shader_watcher.watch(file);
+    }
+  }
+}
+
+void Launcher::rebuild_shader_program(std::string const& name) {
+  auto build = m_program_builds.find(name);
+  if (build != m_program_builds.end()) {
+    shader_loader::cancel_program(build->second);
+    m_program_builds.erase(build);
+  }
+  shader_program const& program = m_application->getShaderPrograms().at(name);
+  try {
+    m_program_builds.emplace(name, shader_loader::build_program({program.vertex_path, program.fragment_path},
+                                                                {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER},
+                                                                program.defines));
+  }
+  catch(std::exception&) {
+    // file not readable while it is replaced, the next change triggers another build
+  }
+}
+
+void Launcher::update_changed_programs() {
+  for (auto const& path : m_shader_watcher.changed()) {
+    for (auto const& pair : m_application->getShaderPrograms()) {
+      if (std::find(pair.second.files.begin(), pair.second.files.end(), path) != pair.second.files.end()) {
+        rebuild_shader_program(pair.first);
+      }
+    }
+  }
+
+  for (auto build = m_program_builds.begin(); build != m_program_builds.end(); ) {
+    // old program is used while the driver compiles in the background
+    if (!shader_loader::program_ready(build->second)) {
+      ++build;
+      continue;
+    }
+    try {
+      // throws exception when compiling was unsuccessfull
+      GLuint new_program = shader_loader::finish_program(build->second);
+      shader_program& program = m_application->getShaderPrograms().at(build->first);
+      // free old shader program
+      glDeleteProgram(program.handle);
+      // save new shader program
+      program.handle = new_program;
+      // includes may have changed
+      program.files = build->second.files;
+      for (auto const& file : program.files) {
+        m_shader_watcher.watch(file);
+      }
+      // only the uniforms of the new program need to be updated
+      m_application->uploadProgramUniforms(build->first);
+    }
+    catch(std::exception&) {
+      // dont crash, keep old program until the next change
+    }
+    build = m_program_builds.erase(build);
+  }
+}
+
 ///////////////////////////// misc functions ////////////////////////////////
 // handle key input
 void Launcher::key_callback(GLFWwindow* m_window, int key, int scancode, int action, int mods) {
@@ -203,7 +304,9 @@ void Launcher::key_callback(GLFWwindow* m_window, int key, int scancode, int act
     glfwSetWindowShouldClose(m_window, 1);
   }
   else if (key == GLFW_KEY_R && action == GLFW_PRESS) {
-    update_shader_programs(false);
+    for (auto const& pair : m_application->getShaderPrograms()) {
+      rebuild_shader_program(pair.first);
+    }
   }
   m_application->keyCallback(key, scancode, action, mods);
 }
@@ -221,7 +324,11 @@ void Launcher::show_fps() {
   double current_time = glfwGetTime();
   if (current_time - m_last_second_time >= 1.0) {
     std::string title{"OpenGL Framework - "};
-    title += std::to_string(m_frames_per_second) + " fps";
+    title += std::to_string(m_frames_per_second) + " fps, ";
+    // redundant state changes skipped by the application
+    std::size_t filtered_calls = m_application->getGlState().filtered();
+    title += std::to_string(filtered_calls - m_filtered_calls) + " gl calls filtered";
+    m_filtered_calls = filtered_calls;
 
     glfwSetWindowTitle(m_window, title.c_str());
     m_frames_per_second = 0;
@@ -230,6 +337,9 @@ void Launcher::show_fps() {
 }
 
 void Launcher::quit(int status) {
+  for (auto& build : m_program_builds) {
+    shader_loader::cancel_program(build.second);
+  }
   // free opengl resources
   delete m_application;
   // free glfw resources
@@ -244,6 +354,35 @@ void glsl_error(int error, const char* description) {
   std::cerr << "GLSL Error " << error << " : "<< description << std::endl;
 }
 
+#if GL_ERROR_CHECKS == 1
+// called by the driver, possibly from another thread and after the failing call returned
+void GL_APIENTRY gl_debug_message(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                  GLchar const* message, void const* user_param) {
+  std::cerr << "OpenGL " << (type == GL_DEBUG_TYPE_ERROR ? "Error" : "Debug")
+            << " (" << glbinding::Meta::getString(severity) << "): " << message << std::endl;
+}
+#endif
+
+#if GL_ERROR_CHECKS == 0
+void watch_gl_errors(bool) {}
+#elif GL_ERROR_CHECKS == 1
+void watch_gl_errors(bool activate) {
+  if (glbinding::ContextInfo::version() < glbinding::Version(4, 3)
+   && glbinding::ContextInfo::extensions().count(GLextension::GL_KHR_debug) == 0) {
+    std::cerr << "Debug output not supported, OpenGL errors are not reported" << std::endl;
+    return;
+  }
+  if (activate) {
+    glDebugMessageCallback(gl_debug_message, nullptr);
+    // notifications are informational, report everything else
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+    glEnable(GL_DEBUG_OUTPUT);
+  }
+  else {
+    glDisable(GL_DEBUG_OUTPUT);
+  }
+}
+#else
 void watch_gl_errors(bool activate) {
   if(activate) {
     // add callback after each function call
@@ -279,3 +418,4 @@ void watch_gl_errors(bool activate) {
     glbinding::setCallbackMask(glbinding::CallbackMask::None);
   }
 }
+#endif
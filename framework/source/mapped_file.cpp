@@ -0,0 +1,82 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdexcept>
+
+#ifdef _WIN32
+mapped_file::mapped_file(std::string const& path)
+ :m_data{nullptr}
+ ,m_size{0}
+ ,m_file{INVALID_HANDLE_VALUE}
+ ,m_mapping{nullptr}
+{
+  m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (m_file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("Opening of " + path);
+  }
+  LARGE_INTEGER file_size;
+  GetFileSizeEx(m_file, &file_size);
+  m_size = std::size_t(file_size.QuadPart);
+  // empty files can not be mapped
+  if (m_size > 0) {
+    m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_mapping) {
+      m_data = static_cast<std::uint8_t const*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!m_data) {
+      if (m_mapping) CloseHandle(m_mapping);
+      CloseHandle(m_file);
+      throw std::runtime_error("Mapping of " + path);
+    }
+  }
+}
+
+mapped_file::~mapped_file() {
+  if (m_data) UnmapViewOfFile(m_data);
+  if (m_mapping) CloseHandle(m_mapping);
+  CloseHandle(m_file);
+}
+#else
+mapped_file::mapped_file(std::string const& path)
+ :m_data{nullptr}
+ ,m_size{0}
+{
+  int file = open(path.c_str(), O_RDONLY);
+  if (file < 0) {
+    throw std::runtime_error("Opening of " + path);
+  }
+  struct stat file_stat;
+  if (fstat(file, &file_stat) != 0) {
+    close(file);
+    throw std::runtime_error("Querying size of " + path);
+  }
+  m_size = std::size_t(file_stat.st_size);
+  // empty files can not be mapped
+  if (m_size > 0) {
+    void* ptr = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (ptr == MAP_FAILED) {
+      close(file);
+      throw std::runtime_error("Mapping of " + path);
+    }
+    m_data = static_cast<std::uint8_t const*>(ptr);
+  }
+  // mapping stays valid after closing the descriptor
+  close(file);
+}
+
+mapped_file::~mapped_file() {
+  if (m_data) {
+    munmap(const_cast<std::uint8_t*>(m_data), m_size);
+  }
+}
+#endif
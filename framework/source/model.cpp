@@ -1,8 +1,10 @@
 #include "model.hpp"
+#include "mapped_file.hpp"
 
 #include <glbinding/gl/enum.h>
 
 #include <cstdint>
+#include <utility>
 
 std::vector<model::attribute> const model::VERTEX_ATTRIBS
  = {
@@ -26,15 +28,18 @@ model::model()
  ,offsets{}
  ,vertex_bytes{0}
  ,vertex_num{0}
+ ,index_type{INDEX.type}
+ ,packed_data{}
+ ,packed_indices{}
+ ,lods{}
+ ,meshlets{}
+ ,mapping{}
+ ,mapped_data{nullptr, 0}
+ ,mapped_indices{nullptr, 0}
 {}
 
-model::model(std::vector<GLfloat> const& databuff, attrib_flag_t contained_attributes, std::vector<GLuint> const& trianglebuff)
- :data(databuff)
- ,indices(trianglebuff)
- ,offsets{}
- ,vertex_bytes{0}
- ,vertex_num{0}
-{
+// fill offsets and vertex bytes for the contained attributes, returns the number of components per vertex
+static std::size_t init_layout(model& target, model::attrib_flag_t contained_attributes) {
   // number of components per vertex
   std::size_t component_num = 0;
 
@@ -42,38 +47,121 @@ model::model(std::vector<GLfloat> const& databuff, attrib_flag_t contained_attri
     // check if buffer contains attribute
     if (supported_attribute.flag & contained_attributes) {
       // write offset, explicit cast to prevent narrowing warning
-      offsets.insert(std::pair<attrib_flag_t, GLvoid*>{supported_attribute, (GLvoid*)uintptr_t(vertex_bytes)});
+      model::attribute contained_attribute{supported_attribute};
+      contained_attribute.offset = (GLvoid*)uintptr_t(target.vertex_bytes);
+      target.offsets.insert(std::pair<model::attrib_flag_t, model::attribute>{supported_attribute, contained_attribute});
       // move offset pointer forward
-      vertex_bytes += supported_attribute.size * supported_attribute.components;
+      target.vertex_bytes += supported_attribute.size * supported_attribute.components;
       // increase number of components
-      component_num += supported_attribute.components;
+      component_num += std::size_t(supported_attribute.components);
     }
   }
-  // set number of vertice sin buffer
-  vertex_num = data.size() / component_num;
+  return component_num;
+}
+
+model::model(std::vector<GLfloat> databuff, attrib_flag_t contained_attributes, std::vector<GLuint> trianglebuff)
+ :data(std::move(databuff))
+ ,indices(std::move(trianglebuff))
+ ,offsets{}
+ ,vertex_bytes{0}
+ ,vertex_num{0}
+ ,index_type{INDEX.type}
+ ,packed_data{}
+ ,packed_indices{}
+ ,lods{}
+ ,meshlets{}
+ ,mapping{}
+ ,mapped_data{nullptr, 0}
+ ,mapped_indices{nullptr, 0}
+{
+  std::size_t component_num = init_layout(*this, contained_attributes);
+  // set number of vertices in buffer
+  vertex_num = component_num > 0 ? data.size() / component_num : 0;
 }
 
-model::model(std::vector<particle> const& databuff, attrib_flag_t contained_attributes, std::vector<GLuint> const& trianglebuff)
-  :data{}
-  ,particle_data(databuff)
-  ,indices(trianglebuff)
-  ,offsets{}
-  ,vertex_bytes{0}
-  ,vertex_num{0} {
-    // number of components per vertex
-    std::size_t component_num = 0;
+model::model(std::vector<particle> databuff, attrib_flag_t contained_attributes, std::vector<GLuint> trianglebuff)
+ :data{}
+ ,particle_data(std::move(databuff))
+ ,indices(std::move(trianglebuff))
+ ,offsets{}
+ ,vertex_bytes{0}
+ ,vertex_num{0}
+ ,index_type{INDEX.type}
+ ,packed_data{}
+ ,packed_indices{}
+ ,lods{}
+ ,meshlets{}
+ ,mapping{}
+ ,mapped_data{nullptr, 0}
+ ,mapped_indices{nullptr, 0}
+{
+  init_layout(*this, contained_attributes);
+  // one vertex per particle
+  vertex_num = particle_data.size();
+}
 
-    for (auto const& supported_attribute : model::VERTEX_ATTRIBS) {
-      // check if buffer contains attribute
-      if (supported_attribute.flag & contained_attributes) {
-        // write offset, explicit cast to prevent narrowing warning
-        offsets.insert(std::pair<attrib_flag_t, GLvoid*>{supported_attribute, (GLvoid*)uintptr_t(vertex_bytes)});
-        // move offset pointer forward
-        vertex_bytes += supported_attribute.size * supported_attribute.components;
-        // increase number of components
-        component_num += supported_attribute.components;
-      }
-    }
-    // set number of vertice sin buffer
-    vertex_num = data.size() / component_num;
+model::buffer_view model::vertex_buffer() const {
+  if (mapping) {
+    return mapped_data;
+  }
+  if (!packed_data.empty()) {
+    return buffer_view{packed_data.data(), packed_data.size()};
   }
+  return buffer_view{data.data(), data.size() * sizeof(GLfloat)};
+}
+
+model::buffer_view model::index_buffer() const {
+  if (mapping) {
+    return mapped_indices;
+  }
+  if (index_type == GL_UNSIGNED_SHORT) {
+    return buffer_view{packed_indices.data(), packed_indices.size() * sizeof(GLushort)};
+  }
+  return buffer_view{indices.data(), indices.size() * sizeof(GLuint)};
+}
+
+std::size_t model::index_num() const {
+  std::size_t index_size = index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+  return index_buffer().bytes / index_size;
+}
+
+void model::unmap() {
+  if (!mapping) {
+    return;
+  }
+  if (index_type == GL_UNSIGNED_SHORT) {
+    GLushort const* index_ptr = static_cast<GLushort const*>(mapped_indices.ptr);
+    packed_indices.assign(index_ptr, index_ptr + mapped_indices.bytes / sizeof(GLushort));
+  }
+  else {
+    GLuint const* index_ptr = static_cast<GLuint const*>(mapped_indices.ptr);
+    indices.assign(index_ptr, index_ptr + mapped_indices.bytes / sizeof(GLuint));
+  }
+  // vertices with non-float attributes are quantized
+  bool packed = false;
+  for (auto const& pair : offsets) {
+    packed = packed || pair.second.type != GL_FLOAT;
+  }
+  if (packed) {
+    std::uint8_t const* vertex_ptr = static_cast<std::uint8_t const*>(mapped_data.ptr);
+    packed_data.assign(vertex_ptr, vertex_ptr + mapped_data.bytes);
+  }
+  else {
+    GLfloat const* vertex_ptr = static_cast<GLfloat const*>(mapped_data.ptr);
+    data.assign(vertex_ptr, vertex_ptr + mapped_data.bytes / sizeof(GLfloat));
+  }
+  mapping.reset();
+  mapped_data = buffer_view{nullptr, 0};
+  mapped_indices = buffer_view{nullptr, 0};
+}
+
+void model::release() {
+  std::vector<GLfloat>().swap(data);
+  std::vector<particle>().swap(particle_data);
+  std::vector<GLuint>().swap(indices);
+  std::vector<std::uint8_t>().swap(packed_data);
+  std::vector<GLushort>().swap(packed_indices);
+  mapping.reset();
+  mapped_data = buffer_view{nullptr, 0};
+  mapped_indices = buffer_view{nullptr, 0};
+}
@@ -0,0 +1,200 @@
+#include "model_cache.hpp"
+#include "mapped_file.hpp"
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace model_cache {
+
+// increase when the layout of the file changes
+static std::uint32_t const VERSION = 2;
+static char const MAGIC[4] = {'M', 'D', 'L', 'C'};
+// alignment of data blocks in the file
+static std::uint64_t const ALIGNMENT = 16;
+
+// fixed size file header, followed by source path, attributes, vertex data and indices
+struct header {
+  char magic[4];
+  std::uint32_t version;
+  // identify source file state
+  std::int64_t source_mtime;
+  std::uint64_t source_size;
+  std::uint32_t path_length;
+  // requested and actually contained attributes
+  std::int32_t import_attribs;
+  std::int32_t contained_attribs;
+  std::uint32_t attribute_num;
+  std::uint32_t vertex_bytes;
+  std::uint32_t index_type;
+  std::uint64_t vertex_num;
+  std::uint64_t data_offset;
+  std::uint64_t data_bytes;
+  std::uint64_t index_offset;
+  std::uint64_t index_bytes;
+};
+
+// per attribute entry
+struct attribute_entry {
+  std::int32_t flag;
+  std::int32_t size;
+  std::int32_t components;
+  std::uint32_t type;
+  std::uint32_t normalized;
+  std::uint32_t offset;
+};
+
+static bool source_state(std::string const& source_path, std::int64_t& mtime, std::uint64_t& size) {
+  struct stat file_stat;
+  if (stat(source_path.c_str(), &file_stat) != 0) {
+    return false;
+  }
+  mtime = std::int64_t(file_stat.st_mtime);
+  size = std::uint64_t(file_stat.st_size);
+  return true;
+}
+
+static std::uint64_t align(std::uint64_t offset) {
+  return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+std::string file_path(std::string const& source_path, model::attrib_flag_t import_attribs) {
+  return source_path + "." + std::to_string(import_attribs) + ".meshcache";
+}
+
+bool load(std::string const& source_path, model::attrib_flag_t import_attribs, model& result) {
+  std::int64_t mtime = 0;
+  std::uint64_t size = 0;
+  if (!source_state(source_path, mtime, size)) {
+    return false;
+  }
+
+  std::shared_ptr<mapped_file> file;
+  try {
+    file = std::make_shared<mapped_file>(file_path(source_path, import_attribs));
+  }
+  catch (std::exception&) {
+    // no cache yet
+    return false;
+  }
+
+  if (file->size() < sizeof(header)) {
+    return false;
+  }
+  header head;
+  std::memcpy(&head, file->data(), sizeof(header));
+  // reject foreign, outdated or truncated caches
+  if (std::memcmp(head.magic, MAGIC, sizeof(MAGIC)) != 0
+   || head.version != VERSION
+   || head.source_mtime != mtime
+   || head.source_size != size
+   || head.import_attribs != import_attribs
+   || (head.index_type != std::uint32_t(GL_UNSIGNED_INT) && head.index_type != std::uint32_t(GL_UNSIGNED_SHORT))
+   || head.data_offset + head.data_bytes > file->size()
+   || head.index_offset + head.index_bytes > file->size()) {
+    return false;
+  }
+  std::uint64_t entries_offset = sizeof(header) + head.path_length;
+  if (entries_offset + head.attribute_num * sizeof(attribute_entry) > head.data_offset) {
+    return false;
+  }
+  // different files may map to the same cache name
+  std::string cached_path(reinterpret_cast<char const*>(file->data() + sizeof(header)), head.path_length);
+  if (cached_path != source_path) {
+    return false;
+  }
+
+  model cached{};
+  for (std::uint32_t i = 0; i < head.attribute_num; ++i) {
+    attribute_entry entry;
+    std::memcpy(&entry, file->data() + entries_offset + i * sizeof(attribute_entry), sizeof(attribute_entry));
+    model::attribute attribute{entry.flag, entry.size, entry.components, GLenum(entry.type), GLboolean(entry.normalized != 0)};
+    attribute.offset = (GLvoid*)uintptr_t(entry.offset);
+    cached.offsets.insert(std::pair<model::attrib_flag_t, model::attribute>{entry.flag, attribute});
+  }
+  cached.vertex_bytes = GLsizei(head.vertex_bytes);
+  cached.vertex_num = std::size_t(head.vertex_num);
+  cached.index_type = GLenum(head.index_type);
+  cached.mapped_data = model::buffer_view{file->data() + head.data_offset, std::size_t(head.data_bytes)};
+  cached.mapped_indices = model::buffer_view{file->data() + head.index_offset, std::size_t(head.index_bytes)};
+  cached.mapping = file;
+
+  result = std::move(cached);
+  return true;
+}
+
+bool store(std::string const& source_path, model::attrib_flag_t import_attribs, model const& source) {
+  header head;
+  std::memset(&head, 0, sizeof(header));
+  if (!source_state(source_path, head.source_mtime, head.source_size)) {
+    return false;
+  }
+
+  model::buffer_view vertices = source.vertex_buffer();
+  model::buffer_view indices = source.index_buffer();
+
+  std::memcpy(head.magic, MAGIC, sizeof(MAGIC));
+  head.version = VERSION;
+  head.path_length = std::uint32_t(source_path.size());
+  head.import_attribs = import_attribs;
+  head.contained_attribs = 0;
+  head.attribute_num = std::uint32_t(source.offsets.size());
+  head.vertex_bytes = std::uint32_t(source.vertex_bytes);
+  head.index_type = std::uint32_t(source.index_type);
+  head.vertex_num = source.vertex_num;
+  head.data_offset = align(sizeof(header) + head.path_length + head.attribute_num * sizeof(attribute_entry));
+  head.data_bytes = vertices.bytes;
+  head.index_offset = align(head.data_offset + head.data_bytes);
+  head.index_bytes = indices.bytes;
+
+  std::vector<attribute_entry> entries{};
+  for (auto const& pair : source.offsets) {
+    head.contained_attribs |= pair.first;
+    model::attribute const& attribute = pair.second;
+    entries.push_back(attribute_entry{attribute.flag, attribute.size, attribute.components, std::uint32_t(attribute.type),
+                                      attribute.normalized == GL_TRUE ? 1u : 0u, std::uint32_t(uintptr_t(attribute.offset))});
+  }
+
+  // write to temporary file and rename, so no partial cache is ever mapped
+  std::string cache_path{file_path(source_path, import_attribs)};
+  std::string temp_path{cache_path + ".tmp"};
+  {
+    std::ofstream ofile(temp_path, std::ios::binary | std::ios::trunc);
+    if (!ofile) {
+      std::cerr << "Cache file \'" << cache_path << "\' not writable" << std::endl;
+      return false;
+    }
+    char const padding[ALIGNMENT] = {0};
+    ofile.write(reinterpret_cast<char const*>(&head), sizeof(header));
+    ofile.write(source_path.data(), std::streamsize(source_path.size()));
+    ofile.write(reinterpret_cast<char const*>(entries.data()), std::streamsize(entries.size() * sizeof(attribute_entry)));
+    std::uint64_t written = sizeof(header) + head.path_length + entries.size() * sizeof(attribute_entry);
+    ofile.write(padding, std::streamsize(head.data_offset - written));
+    ofile.write(static_cast<char const*>(vertices.ptr), std::streamsize(vertices.bytes));
+    written = head.data_offset + head.data_bytes;
+    ofile.write(padding, std::streamsize(head.index_offset - written));
+    ofile.write(static_cast<char const*>(indices.ptr), std::streamsize(indices.bytes));
+    if (!ofile) {
+      std::cerr << "Cache file \'" << cache_path << "\' could not be written" << std::endl;
+      ofile.close();
+      std::remove(temp_path.c_str());
+      return false;
+    }
+  }
+  // rename does not replace existing files on windows
+  std::remove(cache_path.c_str());
+  if (std::rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+};
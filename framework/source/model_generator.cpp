@@ -0,0 +1,341 @@
+#include "model_generator.hpp"
+#include "thread_pool.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace model_generator {
+
+// minimum number of vertices or rows per parallel chunk
+static std::size_t const MIN_CHUNK = 1 << 12;
+static double const PI = 3.14159265358979323846;
+
+// geometry of all levels before interleaving into a model
+struct sphere {
+  std::vector<glm::dvec3> directions;
+  std::vector<glm::dvec2> texcoords;
+  std::vector<GLuint> indices;
+  std::vector<model::lod> lods;
+};
+
+// direction at the angle from the north pole and the angle around the y axis, u = 0 faces +z
+static glm::dvec3 direction(double theta, double phi) {
+  return glm::dvec3{std::sin(theta) * std::sin(phi), std::cos(theta), std::sin(theta) * std::cos(phi)};
+}
+
+// whether the longitude of the direction is undefined
+static bool is_pole(glm::dvec3 const& direction) {
+  return direction.x * direction.x + direction.z * direction.z < 1e-20;
+}
+
+// append triangles of a level in generation order with their deviation from the sphere
+static void add_level(sphere& result, std::vector<GLuint> const& indices) {
+  // farthest point of a triangle inscribed in the sphere is the foot of the perpendicular from the center
+  double error = 0.0;
+  for (std::size_t i = 0; i < indices.size(); i += 3) {
+    glm::dvec3 p0 = result.directions[indices[i]];
+    glm::dvec3 normal = glm::cross(result.directions[indices[i + 1]] - p0, result.directions[indices[i + 2]] - p0);
+    double length = glm::length(normal);
+    if (length > 0.0) {
+      error = std::max(error, 1.0 - std::abs(glm::dot(normal, p0)) / length);
+    }
+  }
+  result.lods.push_back(model::lod{result.indices.size(), indices.size(), float(error), 0, 0});
+  result.indices.insert(result.indices.end(), indices.begin(), indices.end());
+}
+
+// texcoords from the directions, triangles across the seam or touching a pole get copies of the vertices
+static void equirectangular(sphere& result) {
+  std::size_t vertex_num = result.directions.size();
+  result.texcoords.resize(vertex_num);
+  parallel_for(vertex_num, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t v = begin; v < end; ++v) {
+      glm::dvec3 const& d = result.directions[v];
+      double u = std::atan2(d.x, d.z) / (2.0 * PI);
+      double theta = std::acos(std::max(-1.0, std::min(1.0, d.y)));
+      result.texcoords[v] = glm::dvec2{u < 0.0 ? u + 1.0 : u, 1.0 - theta / PI};
+    }
+  }, MIN_CHUNK);
+
+  // copy of a vertex with u + 1, shared by all triangles west of the seam
+  std::vector<GLuint> wrapped(vertex_num, std::numeric_limits<GLuint>::max());
+  for (std::size_t i = 0; i < result.indices.size(); i += 3) {
+    GLuint* corners = &result.indices[i];
+    bool pole[3];
+    double min_u = 1.0;
+    double max_u = 0.0;
+    for (std::size_t c = 0; c < 3; ++c) {
+      pole[c] = is_pole(result.directions[corners[c]]);
+      if (!pole[c]) {
+        min_u = std::min(min_u, result.texcoords[corners[c]].x);
+        max_u = std::max(max_u, result.texcoords[corners[c]].x);
+      }
+    }
+    if (max_u - min_u > 0.5) {
+      for (std::size_t c = 0; c < 3; ++c) {
+        if (pole[c] || result.texcoords[corners[c]].x >= 0.5) continue;
+        if (wrapped[corners[c]] == std::numeric_limits<GLuint>::max()) {
+          wrapped[corners[c]] = GLuint(result.directions.size());
+          result.directions.push_back(result.directions[corners[c]]);
+          result.texcoords.push_back(result.texcoords[corners[c]] + glm::dvec2{1.0, 0.0});
+        }
+        corners[c] = wrapped[corners[c]];
+      }
+    }
+    // the pole takes the mean longitude of the other corners
+    for (std::size_t c = 0; c < 3; ++c) {
+      if (!pole[c]) continue;
+      double u = 0.0;
+      for (std::size_t o = 0; o < 3; ++o) {
+        u += o != c ? result.texcoords[corners[o]].x * 0.5 : 0.0;
+      }
+      result.directions.push_back(result.directions[corners[c]]);
+      result.texcoords.push_back(glm::dvec2{u, result.texcoords[corners[c]].y});
+      corners[c] = GLuint(result.directions.size() - 1);
+    }
+  }
+}
+
+// append components converted to float
+static GLfloat* write(GLfloat* out, double const* components, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    *out++ = GLfloat(components[i]);
+  }
+  return out;
+}
+
+// interleave the requested attributes in the order of model::VERTEX_ATTRIBS
+static model interleave(sphere& source, model::attrib_flag_t attribs) {
+  attribs |= model::POSITION;
+  std::size_t component_num = 0;
+  for (auto const& attribute : model::VERTEX_ATTRIBS) {
+    component_num += attribute.flag & attribs ? std::size_t(attribute.components) : 0;
+  }
+  std::size_t vertex_num = source.directions.size();
+  std::vector<GLfloat> data(vertex_num * component_num);
+  parallel_for(vertex_num, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t v = begin; v < end; ++v) {
+      glm::dvec3 const& normal = source.directions[v];
+      glm::dvec2 const& texcoord = source.texcoords[v];
+      // derivative of the position along u, also defined at the poles
+      double phi = 2.0 * PI * texcoord.x;
+      glm::dvec3 tangent{std::cos(phi), 0.0, -std::sin(phi)};
+      glm::dvec3 bitangent = glm::cross(normal, tangent);
+      GLfloat* vertex = &data[v * component_num];
+      vertex = write(vertex, &normal.x, 3);
+      if (attribs & model::NORMAL) {
+        vertex = write(vertex, &normal.x, 3);
+      }
+      if (attribs & model::TEXCOORD) {
+        vertex = write(vertex, &texcoord.x, 2);
+      }
+      if (attribs & model::TANGENT) {
+        vertex = write(vertex, &tangent.x, 3);
+      }
+      if (attribs & model::BITANGENT) {
+        vertex = write(vertex, &bitangent.x, 3);
+      }
+    }
+  }, MIN_CHUNK);
+
+  model result{std::move(data), attribs, std::move(source.indices)};
+  result.lods.swap(source.lods);
+  return result;
+}
+
+model uv_sphere(std::size_t segments, std::size_t rings, model::attrib_flag_t attribs, std::size_t level_num) {
+  if (segments < 3 || rings < 2) {
+    throw std::invalid_argument("UV sphere needs at least 3 segments and 2 rings");
+  }
+  // rows between the poles, pole vertices are added per level and segment
+  std::size_t columns = segments + 1;
+  sphere result{};
+  result.directions.resize((rings - 1) * columns);
+  result.texcoords.resize(result.directions.size());
+  parallel_for(rings - 1, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t row = begin; row < end; ++row) {
+      double v = double(row + 1) / double(rings);
+      for (std::size_t s = 0; s < columns; ++s) {
+        double u = double(s) / double(segments);
+        result.directions[row * columns + s] = direction(v * PI, u * 2.0 * PI);
+        result.texcoords[row * columns + s] = glm::dvec2{u, 1.0 - v};
+      }
+    }
+  }, MIN_CHUNK / columns + 1);
+
+  for (std::size_t level = 0, step = 1; level < level_num; ++level, step *= 2) {
+    if (segments % step != 0 || rings % step != 0 || segments / step < 3 || rings / step < 2) {
+      break;
+    }
+    std::size_t level_segments = segments / step;
+    std::size_t level_rings = rings / step;
+    GLuint north = GLuint(result.directions.size());
+    GLuint south = GLuint(north + level_segments);
+    for (std::size_t s = 0; s < level_segments; ++s) {
+      double u = (double(s) + 0.5) / double(level_segments);
+      result.directions.push_back(glm::dvec3{0.0, 1.0, 0.0});
+      result.texcoords.push_back(glm::dvec2{u, 1.0});
+    }
+    for (std::size_t s = 0; s < level_segments; ++s) {
+      double u = (double(s) + 0.5) / double(level_segments);
+      result.directions.push_back(glm::dvec3{0.0, -1.0, 0.0});
+      result.texcoords.push_back(glm::dvec2{u, 0.0});
+    }
+
+    // fans around the poles take 3 indices per segment, the rows between 6
+    std::vector<GLuint> indices((level_rings - 1) * level_segments * 6);
+    parallel_for(level_rings, [&](std::size_t, std::size_t begin, std::size_t end) {
+      for (std::size_t ring = begin; ring < end; ++ring) {
+        GLuint* out = &indices[(ring == 0 ? 0 : (ring * 2 - 1) * 3) * level_segments];
+        // first vertex of the upper and lower row, the grid has no pole rows
+        std::size_t upper = ring > 0 ? (ring * step - 1) * columns : 0;
+        std::size_t lower = ring + 1 < level_rings ? ((ring + 1) * step - 1) * columns : 0;
+        for (std::size_t s = 0; s < level_segments; ++s) {
+          GLuint a = GLuint(upper + s * step);
+          GLuint b = GLuint(lower + s * step);
+          GLuint c = GLuint(a + step);
+          GLuint d = GLuint(b + step);
+          if (ring == 0) {
+            GLuint triangle[] = {GLuint(north + s), b, d};
+            out = std::copy(triangle, triangle + 3, out);
+          }
+          else if (ring + 1 == level_rings) {
+            GLuint triangle[] = {a, GLuint(south + s), c};
+            out = std::copy(triangle, triangle + 3, out);
+          }
+          else {
+            GLuint quad[] = {a, b, c, c, b, d};
+            out = std::copy(quad, quad + 6, out);
+          }
+        }
+      }
+    }, MIN_CHUNK / level_segments + 1);
+    add_level(result, indices);
+  }
+  return interleave(result, attribs);
+}
+
+model cube_sphere(std::size_t subdivisions, model::attrib_flag_t attribs, std::size_t level_num) {
+  if (subdivisions < 1) {
+    throw std::invalid_argument("Cube sphere needs at least 1 subdivision");
+  }
+  // faces do not share vertices, shared edges are computed bit identically from the lattice point
+  std::size_t columns = subdivisions + 1;
+  std::size_t face_size = columns * columns;
+  sphere result{};
+  result.directions.resize(6 * face_size);
+  parallel_for(6 * columns, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t row = begin; row < end; ++row) {
+      std::size_t face = row / columns;
+      std::size_t j = row % columns;
+      std::size_t axis = face / 2;
+      for (std::size_t i = 0; i < columns; ++i) {
+        glm::dvec3 cube{};
+        cube[int(axis)] = face % 2 == 0 ? 1.0 : -1.0;
+        cube[int((axis + 1) % 3)] = double(2 * i) / double(subdivisions) - 1.0;
+        cube[int((axis + 2) % 3)] = double(2 * j) / double(subdivisions) - 1.0;
+        // mapping with less distortion than normalizing
+        glm::dvec3 squared = cube * cube;
+        glm::dvec3 mapped{};
+        for (int a = 0; a < 3; ++a) {
+          double b = squared[(a + 1) % 3];
+          double c = squared[(a + 2) % 3];
+          mapped[a] = cube[a] * std::sqrt(1.0 - b * 0.5 - c * 0.5 + b * c / 3.0);
+        }
+        result.directions[face * face_size + j * columns + i] = glm::normalize(mapped);
+      }
+    }
+  }, MIN_CHUNK / columns + 1);
+
+  for (std::size_t level = 0, step = 1; level < level_num; ++level, step *= 2) {
+    if (subdivisions % step != 0) {
+      break;
+    }
+    std::size_t cells = subdivisions / step;
+    std::vector<GLuint> indices(6 * cells * cells * 6);
+    parallel_for(6 * cells, [&](std::size_t, std::size_t begin, std::size_t end) {
+      for (std::size_t row = begin; row < end; ++row) {
+        std::size_t face = row / cells;
+        std::size_t j = row % cells * step;
+        GLuint* out = &indices[row * cells * 6];
+        for (std::size_t i = 0; i < subdivisions; i += step) {
+          GLuint a = GLuint(face * face_size + j * columns + i);
+          GLuint b = GLuint(a + step);
+          GLuint c = GLuint(a + step * columns);
+          GLuint d = GLuint(c + step);
+          // the tangential axes of negative faces are mirrored
+          GLuint positive[] = {a, b, c, c, b, d};
+          GLuint negative[] = {a, c, b, b, c, d};
+          GLuint const* quad = face % 2 == 0 ? positive : negative;
+          out = std::copy(quad, quad + 6, out);
+        }
+      }
+    }, MIN_CHUNK / cells + 1);
+    add_level(result, indices);
+  }
+  equirectangular(result);
+  return interleave(result, attribs);
+}
+
+model icosphere(std::size_t subdivisions, model::attrib_flag_t attribs, std::size_t level_num) {
+  double const t = (1.0 + std::sqrt(5.0)) * 0.5;
+  sphere result{};
+  result.directions = {
+    {-1.0, t, 0.0}, {1.0, t, 0.0}, {-1.0, -t, 0.0}, {1.0, -t, 0.0},
+    {0.0, -1.0, t}, {0.0, 1.0, t}, {0.0, -1.0, -t}, {0.0, 1.0, -t},
+    {t, 0.0, -1.0}, {t, 0.0, 1.0}, {-t, 0.0, -1.0}, {-t, 0.0, 1.0}
+  };
+  for (auto& corner : result.directions) {
+    corner = glm::normalize(corner);
+  }
+  // triangles of each subdivision step, finest last
+  std::vector<std::vector<GLuint>> steps{{
+    0, 11, 5,  0, 5, 1,  0, 1, 7,  0, 7, 10,  0, 10, 11,
+    1, 5, 9,  5, 11, 4,  11, 10, 2,  10, 7, 6,  7, 1, 8,
+    3, 9, 4,  3, 4, 2,  3, 2, 6,  3, 6, 8,  3, 8, 9,
+    4, 9, 5,  2, 4, 11,  6, 2, 10,  8, 6, 7,  9, 8, 1
+  }};
+
+  // vertices of coarser steps keep their index, edge midpoints are appended
+  for (std::size_t step = 0; step < subdivisions; ++step) {
+    std::vector<GLuint> const& coarse = steps.back();
+    std::unordered_map<std::uint64_t, GLuint> midpoints{};
+    midpoints.reserve(coarse.size());
+    auto midpoint = [&](GLuint a, GLuint b) {
+      std::uint64_t key = std::uint64_t(std::min(a, b)) << 32 | std::max(a, b);
+      auto inserted = midpoints.insert(std::make_pair(key, GLuint(result.directions.size())));
+      if (inserted.second) {
+        result.directions.push_back(glm::normalize(result.directions[a] + result.directions[b]));
+      }
+      return inserted.first->second;
+    };
+    std::vector<GLuint> fine{};
+    fine.reserve(coarse.size() * 4);
+    for (std::size_t i = 0; i < coarse.size(); i += 3) {
+      GLuint a = coarse[i];
+      GLuint b = coarse[i + 1];
+      GLuint c = coarse[i + 2];
+      GLuint ab = midpoint(a, b);
+      GLuint bc = midpoint(b, c);
+      GLuint ca = midpoint(c, a);
+      fine.insert(fine.end(), {a, ab, ca,  ab, b, bc,  ca, bc, c,  ab, bc, ca});
+    }
+    steps.push_back(fine);
+  }
+
+  for (std::size_t level = 0; level < level_num && level < steps.size(); ++level) {
+    add_level(result, steps[steps.size() - 1 - level]);
+  }
+  equirectangular(result);
+  return interleave(result, attribs);
+}
+
+};
@@ -1,195 +1,284 @@
 #include "model_loader.hpp"
+#include "model_cache.hpp"
+#include "obj_parser.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
 
-// use floats and med precision operations
-#include <glm/gtc/type_precision.hpp>
-#include <glm/geometric.hpp>
-
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <utility>
 
 namespace model_loader {
 
-void generate_normals(tinyobj::mesh_t& model);
+// minimum number of triangles or vertices per parallel chunk
+static std::size_t const MIN_CHUNK = 1 << 14;
 
-std::vector<glm::fvec3> generate_tangents(tinyobj::mesh_t const& model);
+// vertex sums of one chunk of triangles as xyz array, only covering the vertex range the chunk references
+struct accumulator {
+  std::size_t first;
+  std::size_t count;
+  std::vector<float> sums;
+};
 
 model obj(std::string const& name, model::attrib_flag_t import_attribs) {
-  std::vector<tinyobj::shape_t> shapes;
-  std::vector<tinyobj::material_t> materials;
-
-  std::string err = tinyobj::LoadObj(shapes, materials, name.c_str());
-
-  if (!err.empty()) {
-    if (err[0] == 'W' && err[1] == 'A' && err[2] == 'R') {
-      std::cerr << "tinyobjloader: " << err << std::endl;
-    }
-    else {
-      throw std::logic_error("tinyobjloader: " + err);
-    }
+  model result{};
+  // reuse processed model from previous run
+  if (model_cache::load(name, import_attribs, result)) {
+    return result;
   }
 
-  model::attrib_flag_t attributes{model::POSITION | import_attribs};
-
-  std::vector<float> vertex_data;
-  std::vector<unsigned> triangles;
+  // parses in parallel, materials are not needed
+  std::vector<tinyobj::shape_t> shapes = obj_parser::file(name);
 
-  unsigned vertex_offset = 0;
+  model::attrib_flag_t attributes{model::POSITION | import_attribs};
 
+  // drop attributes missing in any shape, so the vertex size is known before copying
+  std::size_t vertex_total = 0;
+  std::size_t index_total = 0;
   for (auto& shape : shapes) {
     tinyobj::mesh_t& curr_mesh = shape.mesh;
-    // prevent MSVC warning due to Win BOOL implementation
-    bool has_normals = (import_attribs & model::NORMAL) != 0;
-    if(has_normals) {
-      // generate normals if necessary
-      if (curr_mesh.normals.empty()) {
-        generate_normals(curr_mesh);
-      }
+    // generate normals if necessary
+    if ((attributes & model::NORMAL) && curr_mesh.normals.empty()) {
+      generate_normals(curr_mesh);
     }
-
-    bool has_uvs = (import_attribs & model::TEXCOORD) != 0;
-    if(has_uvs) {
-      if (curr_mesh.texcoords.empty()) {
-        has_uvs = false;
-        attributes ^= model::TEXCOORD;
-        std::cerr << "Shape has no texcoords" << std::endl;
-      }
+    if ((attributes & (model::TEXCOORD | model::TANGENT)) && curr_mesh.texcoords.empty()) {
+      attributes &= ~(model::TEXCOORD | model::TANGENT);
+      std::cerr << "Shape has no texcoords" << std::endl;
     }
-
-    bool has_tangents = import_attribs & model::TANGENT;
-    std::vector<glm::fvec3> tangents;
+    vertex_total += curr_mesh.positions.size() / 3;
+    index_total += curr_mesh.indices.size();
+  }
+  // prevent MSVC warning due to Win BOOL implementation
+  bool has_normals = (attributes & model::NORMAL) != 0;
+  bool has_uvs = (attributes & model::TEXCOORD) != 0;
+  bool has_tangents = (attributes & model::TANGENT) != 0;
+  std::size_t component_num = 3 + (has_normals ? 3 : 0) + (has_uvs ? 2 : 0) + (has_tangents ? 3 : 0);
+
+  // sized once, the model takes the buffers over without copying
+  std::vector<float> vertex_data(vertex_total * component_num);
+  std::vector<unsigned> triangles(index_total);
+
+  std::size_t vertex_offset = 0;
+  std::size_t index_offset = 0;
+  for (auto& shape : shapes) {
+    tinyobj::mesh_t& curr_mesh = shape.mesh;
+    std::vector<float> tangents;
     if (has_tangents) {
-      if (!has_uvs) {
-        has_tangents = false;
-        attributes ^= model::TANGENT;
-        std::cerr << "Shape has no texcoords" << std::endl;
-      }
-      else {
-        tangents = generate_tangents(curr_mesh);
-      }
+      tangents = generate_tangents(curr_mesh);
     }
 
-    // push back vertex attributes
-    for (unsigned i = 0; i < curr_mesh.positions.size() / 3; ++i) {
-      vertex_data.push_back(curr_mesh.positions[i * 3]);
-      vertex_data.push_back(curr_mesh.positions[i * 3 + 1]);
-      vertex_data.push_back(curr_mesh.positions[i * 3 + 2]);
-
+    // interleave vertex attributes
+    std::size_t vertex_num = curr_mesh.positions.size() / 3;
+    for (std::size_t i = 0; i < vertex_num; ++i) {
+      float* vertex = &vertex_data[(vertex_offset + i) * component_num];
+      vertex = std::copy_n(&curr_mesh.positions[i * 3], 3, vertex);
       if (has_normals) {
-        vertex_data.push_back(curr_mesh.normals[i * 3]);
-        vertex_data.push_back(curr_mesh.normals[i * 3 + 1]);
-        vertex_data.push_back(curr_mesh.normals[i * 3 + 2]);
+        vertex = std::copy_n(&curr_mesh.normals[i * 3], 3, vertex);
       }
-
       if (has_uvs) {
-        vertex_data.push_back(curr_mesh.texcoords[i * 2]);
-        vertex_data.push_back(curr_mesh.texcoords[i * 2 + 1]);
+        vertex = std::copy_n(&curr_mesh.texcoords[i * 2], 2, vertex);
       }
-
       if (has_tangents) {
-        vertex_data.push_back(tangents[i].x);
-        vertex_data.push_back(tangents[i].y);
-        vertex_data.push_back(tangents[i].z);
+        vertex = std::copy_n(&tangents[i * 3], 3, vertex);
       }
     }
 
     // add triangles
-    for (unsigned i = 0; i < curr_mesh.indices.size(); ++i) {
-      triangles.push_back(vertex_offset + curr_mesh.indices[i]);
+    for (std::size_t i = 0; i < curr_mesh.indices.size(); ++i) {
+      triangles[index_offset + i] = unsigned(vertex_offset) + curr_mesh.indices[i];
     }
 
-    vertex_offset += unsigned(curr_mesh.positions.size() / 3);
+    vertex_offset += vertex_num;
+    index_offset += curr_mesh.indices.size();
+    // free the shape before the next one is copied
+    curr_mesh = tinyobj::mesh_t{};
   }
 
-  return model{vertex_data, attributes, triangles};
+  result = model{std::move(vertex_data), attributes, std::move(triangles)};
+  // failing to write the cache only costs time on the next run
+  model_cache::store(name, import_attribs, result);
+  return result;
 }
 
-void generate_normals(tinyobj::mesh_t& model) {
-  std::vector<glm::fvec3> positions(model.positions.size() / 3);
+// sum the face vector of each triangle into its vertices. the first chunk sums directly into the
+// zeroed xyz array output, the others into own accumulators so no synchronization is needed.
+// the scattered adds stay scalar, gathering corners into simd lanes costs more than it saves
+template<typename F>
+static std::vector<accumulator> accumulate_faces(std::vector<unsigned> const& indices, F const& face, float* output) {
+  std::size_t triangle_num = indices.size() / 3;
+  std::vector<accumulator> sums(parallel_chunks(triangle_num, MIN_CHUNK));
+
+  parallel_for(triangle_num, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+    accumulator& sum = sums[chunk];
+    unsigned first = 0;
+    float* vertices = output;
+    if (chunk > 0) {
+      // find the referenced range to save memory
+      first = std::numeric_limits<unsigned>::max();
+      unsigned last = 0;
+      for (std::size_t i = begin * 3; i < end * 3; ++i) {
+        first = std::min(first, indices[i]);
+        last = std::max(last, indices[i]);
+      }
+      sum.first = first;
+      sum.count = std::size_t(last) + 1 - first;
+      sum.sums.assign(sum.count * 3, 0.0f);
+      vertices = sum.sums.data();
+    }
 
-  for (unsigned i = 0; i < model.positions.size(); i+=3) {
-    positions[i / 3] = glm::fvec3{model.positions[i], model.positions[i + 1], model.positions[i + 2]};
-  }
+    for (std::size_t t = begin; t < end; ++t) {
+      unsigned const* corners = &indices[t * 3];
+      float vector[3];
+      face(corners, vector);
+      for (std::size_t c = 0; c < 3; ++c) {
+        float* vertex = &vertices[(corners[c] - first) * 3];
+        vertex[0] += vector[0];
+        vertex[1] += vector[1];
+        vertex[2] += vector[2];
+      }
+    }
+  }, MIN_CHUNK);
 
-  std::vector<glm::fvec3> normals(model.positions.size() / 3, glm::fvec3{0.0f});
-  for (unsigned i = 0; i < model.indices.size(); i+=3) {
-    glm::fvec3 normal = glm::cross(positions[model.indices[i+1]] - positions[model.indices[i]], positions[model.indices[i+2]] - positions[model.indices[i]]);
+  return sums;
+}
 
-    normals[model.indices[i]] += normal;
-    normals[model.indices[i+1]] += normal;
-    normals[model.indices[i+2]] += normal;
+// load count <= WIDTH xyz vectors starting at vertex first, unused lanes are zero
+static void load_vertices(float const* data, std::size_t first, std::size_t count,
+                          simd::floats& x, simd::floats& y, simd::floats& z) {
+  if (count == simd::WIDTH) {
+    simd::load3(&data[first * 3], x, y, z);
+    return;
   }
+  float values[simd::WIDTH * 3] = {};
+  std::copy_n(&data[first * 3], count * 3, values);
+  simd::load3(values, x, y, z);
+}
 
-  model.normals.reserve(model.positions.size());
-  for (unsigned i = 0; i < normals.size(); ++i) {
-    glm::fvec3 normal = glm::normalize(normals[i]);
-    model.normals[i * 3] = normal[0];
-    model.normals[i * 3 + 1] = normal[1];
-    model.normals[i * 3 + 2] = normal[2];
+// store count <= WIDTH xyz vectors starting at vertex first
+static void store_vertices(float* data, std::size_t first, std::size_t count,
+                           simd::floats x, simd::floats y, simd::floats z) {
+  if (count == simd::WIDTH) {
+    simd::store3(&data[first * 3], x, y, z);
+    return;
   }
+  float values[simd::WIDTH * 3];
+  simd::store3(values, x, y, z);
+  std::copy_n(values, count * 3, &data[first * 3]);
 }
 
-std::vector<glm::fvec3> generate_tangents(tinyobj::mesh_t const& model) {
-  // containers for vertex attributes
-  std::vector<glm::fvec3> positions(model.positions.size() / 3);
-  std::vector<glm::fvec3> normals(model.positions.size() / 3);
-  std::vector<glm::fvec2> texcoords(model.positions.size() / 3);
-  // 1. start with null-vectors for vertex tangents ti
-  std::vector<glm::fvec3> tangents(model.positions.size() / 3, glm::fvec3{0.0f});
-
-  // get vertex positions and texture coordinates from mesh_t
-  for (unsigned i = 0; i < model.positions.size(); i+=3) {
-    positions[i / 3] = glm::fvec3{model.positions[i],
-                                 model.positions[i + 1],
-                                 model.positions[i + 2]};
-    normals[i / 3] = glm::fvec3{model.normals[i],
-                                 model.normals[i + 1],
-                                 model.normals[i + 2]};
-  }
-  for (unsigned i = 0; i < model.texcoords.size(); i+=2) {
-    texcoords[i / 2] = glm::fvec2{model.texcoords[i], model.texcoords[i + 1]};
+// add sums of the chunk accumulators to count <= WIDTH vertices starting at first
+static void reduce(std::vector<accumulator> const& sums, std::size_t first, std::size_t count,
+                   simd::floats& x, simd::floats& y, simd::floats& z) {
+  for (auto const& sum : sums) {
+    std::size_t sum_end = sum.first + sum.count;
+    if (sum.first >= first + count || sum_end <= first) {
+      continue;
+    }
+    simd::floats sum_x, sum_y, sum_z;
+    if (sum.first <= first && first + count <= sum_end) {
+      load_vertices(sum.sums.data(), first - sum.first, count, sum_x, sum_y, sum_z);
+    }
+    else {
+      // chunk covers only part of the vertices
+      float values[simd::WIDTH * 3] = {};
+      std::size_t begin = std::max(first, sum.first);
+      std::size_t end = std::min(first + count, sum_end);
+      std::copy(&sum.sums[(begin - sum.first) * 3], &sum.sums[0] + (end - sum.first) * 3, &values[(begin - first) * 3]);
+      simd::load3(values, sum_x, sum_y, sum_z);
+    }
+    x = simd::add(x, sum_x);
+    y = simd::add(y, sum_y);
+    z = simd::add(z, sum_z);
   }
+}
 
-  // calculate tangent for triangles
-  for (unsigned i = 0; i < model.indices.size() / 3; i++) {
-    // indices of vertices of this triangle
-    unsigned indices[3] = {model.indices[i * 3],
-                           model.indices[i * 3 + 1],
-                           model.indices[i * 3 + 2]};
-    // access an attribute of xth vert with vector access "attribute[indices[x]]"
-
-    // calculate tangent for the triangle and add it to the accumulation tangents of the adjacent vertices
-    // see generate_normals() for similar workflow
-
-    // delta p1 and delta p2
-    glm::fvec3 p1 = positions[indices[1]] - positions[indices[0]];
-    glm::fvec3 p2 = positions[indices[2]] - positions[indices[0]];
-
-    // delta u and delta v
-    glm::fvec2 u = texcoords[indices[1]] - texcoords[indices[0]];
-    glm::fvec2 v = texcoords[indices[2]] - texcoords[indices[0]];
-
-    // uv-coordinate matrix
-    glm::mat2x2 uv_mat = glm::mat2x2 {{v.y, -u.x}, {-v.x, u.y}};
-    glm::mat2x3 delta_p_mat = glm::mat2x3 {{p1.x, p1.y, p1.z}, {p2.x, p2.y, p2.z}};
-    glm::mat3x2 middle_mat = (1.0f / (u.x * v.y - u.y * v.x)) * uv_mat * transpose(delta_p_mat); // 2x2 * 2x3 not possible
-
-    // 2. a. calculate tangent t of current triangle and normalize it
-    glm::fvec3 tangent = glm::fvec3(middle_mat[0][0], middle_mat[1][0], middle_mat[2][0]);
-
-    // 2. b. add tangent to ti of the three vertices forming the triangle
-    tangents[indices[0]] += tangent;
-    tangents[indices[1]] += tangent;
-    tangents[indices[2]] += tangent;
-  }
+// add the chunk sums to the xyz array output and pass its vertices WIDTH at a time to resolve,
+// which replaces them with its result
+template<typename F>
+static void resolve_vertices(std::vector<accumulator> const& sums, std::size_t vertex_num, float* output, F const& resolve) {
+  parallel_for(vertex_num, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t v = begin; v < end; v += simd::WIDTH) {
+      std::size_t count = std::min(simd::WIDTH, end - v);
+      simd::floats x, y, z;
+      load_vertices(output, v, count, x, y, z);
+      reduce(sums, v, count, x, y, z);
+      resolve(v, count, x, y, z);
+      store_vertices(output, v, count, x, y, z);
+    }
+  }, MIN_CHUNK);
+}
 
-  // normalize and orthogonalize accumulated vertex tangents
-  for (unsigned i = 0; i < tangents.size(); ++i) {
-    // 3. a. orthogonalize tangent relative to normal
-    glm::fvec3 norm_tangent = tangents[i] - normals[i] * glm::dot(normals[i], tangents[i]);
-    // 3. b. normalize tangent
-    tangents[i] = normalize(norm_tangent);
-  }
+static void normalize(simd::floats& x, simd::floats& y, simd::floats& z) {
+  simd::floats length = simd::sqrt(simd::mul_add(x, x, simd::mul_add(y, y, simd::mul(z, z))));
+  simd::floats inverse = simd::reciprocal_or_zero(length);
+  x = simd::mul(x, inverse);
+  y = simd::mul(y, inverse);
+  z = simd::mul(z, inverse);
+}
+
+void generate_normals(tinyobj::mesh_t& model) {
+  std::size_t vertex_num = model.positions.size() / 3;
+  float const* positions = model.positions.data();
+
+  // area weighted face normals
+  auto face_normal = [positions](unsigned const* corners, float (&normal)[3]) {
+    float const* p0 = &positions[corners[0] * 3];
+    float const* p1 = &positions[corners[1] * 3];
+    float const* p2 = &positions[corners[2] * 3];
+    float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+  };
+  model.normals.assign(vertex_num * 3, 0.0f);
+  std::vector<accumulator> sums = accumulate_faces(model.indices, face_normal, model.normals.data());
+  resolve_vertices(sums, vertex_num, model.normals.data(), [](std::size_t, std::size_t,
+                                                             simd::floats& x, simd::floats& y, simd::floats& z) {
+    normalize(x, y, z);
+  });
+}
+
+std::vector<float> generate_tangents(tinyobj::mesh_t const& model) {
+  std::size_t vertex_num = model.positions.size() / 3;
+  float const* positions = model.positions.data();
+  float const* texcoords = model.texcoords.data();
+
+  // tangent of triangle, solving [dp1 dp2] = [t b] * [duv1 duv2]
+  auto face_tangent = [positions, texcoords](unsigned const* corners, float (&tangent)[3]) {
+    float const* p0 = &positions[corners[0] * 3];
+    float const* p1 = &positions[corners[1] * 3];
+    float const* p2 = &positions[corners[2] * 3];
+    float const* uv0 = &texcoords[corners[0] * 2];
+    float const* uv1 = &texcoords[corners[1] * 2];
+    float const* uv2 = &texcoords[corners[2] * 2];
+    float duv1[2] = {uv1[0] - uv0[0], uv1[1] - uv0[1]};
+    float duv2[2] = {uv2[0] - uv0[0], uv2[1] - uv0[1]};
+    float det = duv1[0] * duv2[1] - duv1[1] * duv2[0];
+    // degenerate uv mapping contributes nothing
+    float r = det != 0.0f ? 1.0f / det : 0.0f;
+    for (std::size_t c = 0; c < 3; ++c) {
+      tangent[c] = ((p1[c] - p0[c]) * duv2[1] - (p2[c] - p0[c]) * duv1[1]) * r;
+    }
+  };
+  std::vector<float> tangents(vertex_num * 3, 0.0f);
+  std::vector<accumulator> sums = accumulate_faces(model.indices, face_tangent, tangents.data());
+  float const* normals = model.normals.size() >= vertex_num * 3 ? model.normals.data() : nullptr;
+  resolve_vertices(sums, vertex_num, tangents.data(), [normals](std::size_t first, std::size_t count,
+                                                                simd::floats& x, simd::floats& y, simd::floats& z) {
+    // orthogonalize tangent relative to normal
+    if (normals) {
+      simd::floats n_x, n_y, n_z;
+      load_vertices(normals, first, count, n_x, n_y, n_z);
+      simd::floats n_dot_t = simd::mul_add(n_x, x, simd::mul_add(n_y, y, simd::mul(n_z, z)));
+      x = simd::sub(x, simd::mul(n_x, n_dot_t));
+      y = simd::sub(y, simd::mul(n_y, n_dot_t));
+      z = simd::sub(z, simd::mul(n_z, n_dot_t));
+    }
+    normalize(x, y, z);
+  });
 
-  // throw std::logic_error("Tangent creation not implemented yet");
   return tangents;
 }
 };
@@ -0,0 +1,155 @@
+#include "model_meshlets.hpp"
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+namespace model_meshlets {
+
+// sphere around the box of the vertices and cone around the mean triangle normal
+static void compute_bounds(model::meshlet& meshlet, std::vector<GLuint> const& indices,
+                           GLfloat const* positions, std::size_t stride) {
+  glm::fvec3 min_corner{std::numeric_limits<float>::max()};
+  glm::fvec3 max_corner{-std::numeric_limits<float>::max()};
+  for (std::size_t i = meshlet.first_index; i < meshlet.first_index + meshlet.index_num; ++i) {
+    GLfloat const* p = positions + indices[i] * stride;
+    min_corner = glm::min(min_corner, glm::fvec3{p[0], p[1], p[2]});
+    max_corner = glm::max(max_corner, glm::fvec3{p[0], p[1], p[2]});
+  }
+  meshlet.center = (min_corner + max_corner) * 0.5f;
+  meshlet.radius = 0.0f;
+
+  std::vector<glm::fvec3> normals{};
+  normals.reserve(meshlet.index_num / 3);
+  glm::fvec3 axis{0.0f};
+  for (std::size_t i = meshlet.first_index; i < meshlet.first_index + meshlet.index_num; i += 3) {
+    glm::fvec3 corners[3];
+    for (std::size_t c = 0; c < 3; ++c) {
+      GLfloat const* p = positions + indices[i + c] * stride;
+      corners[c] = glm::fvec3{p[0], p[1], p[2]};
+      meshlet.radius = std::max(meshlet.radius, glm::length(corners[c] - meshlet.center));
+    }
+    glm::fvec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+    float length = glm::length(normal);
+    if (length <= 0.0f) continue;
+    normals.push_back(normal / length);
+    axis += normals.back();
+  }
+
+  // a cutoff of -1 never culls
+  meshlet.cone_axis = glm::fvec3{0.0f, 0.0f, 1.0f};
+  meshlet.cone_cutoff = -1.0f;
+  float axis_length = glm::length(axis);
+  if (normals.empty() || axis_length <= 0.0f) {
+    return;
+  }
+  meshlet.cone_axis = axis / axis_length;
+  meshlet.cone_cutoff = 1.0f;
+  for (auto const& normal : normals) {
+    meshlet.cone_cutoff = std::min(meshlet.cone_cutoff, glm::dot(normal, meshlet.cone_axis));
+  }
+}
+
+void build(model& source, std::size_t max_vertices, std::size_t max_triangles) {
+  source.unmap();
+  if (!source.packed_data.empty() || source.index_type != model::INDEX.type) {
+    throw std::logic_error("Model is quantized, build meshlets before quantizing");
+  }
+  if (max_vertices < 3 || max_triangles < 1) {
+    throw std::invalid_argument("Meshlets need at least 3 vertices and 1 triangle");
+  }
+  model::attribute const& position = source.offsets.at(model::POSITION);
+  std::size_t stride = std::size_t(source.vertex_bytes) / sizeof(GLfloat);
+  GLfloat const* positions = source.data.data() + std::size_t(uintptr_t(position.offset)) / sizeof(GLfloat);
+
+  // without levels of detail the whole index buffer is one level
+  std::vector<model::lod> levels = source.lods;
+  if (levels.empty()) {
+    levels.push_back(model::lod{0, source.indices.size(), 0.0f, 0, 0});
+  }
+
+  std::vector<model::meshlet> meshlets{};
+  // meshlet in which a vertex was last used, to count unique vertices
+  std::vector<std::size_t> last_use(source.vertex_num, std::numeric_limits<std::size_t>::max());
+  for (auto& level : levels) {
+    level.first_meshlet = meshlets.size();
+    std::size_t end = level.first_index + level.index_num;
+    std::size_t i = level.first_index;
+    while (i < end) {
+      std::size_t id = meshlets.size();
+      model::meshlet meshlet{i, 0, glm::fvec3{0.0f}, 0.0f, glm::fvec3{0.0f}, -1.0f};
+      std::size_t vertex_num = 0;
+      // indices are cache optimized, so consecutive triangles share most vertices
+      while (i < end && meshlet.index_num / 3 < max_triangles) {
+        std::size_t new_vertices = 0;
+        for (std::size_t c = 0; c < 3; ++c) {
+          GLuint index = source.indices[i + c];
+          bool repeated = (c > 0 && source.indices[i] == index) || (c > 1 && source.indices[i + 1] == index);
+          new_vertices += last_use[index] != id && !repeated ? 1 : 0;
+        }
+        if (vertex_num + new_vertices > max_vertices) {
+          break;
+        }
+        for (std::size_t c = 0; c < 3; ++c) {
+          last_use[source.indices[i + c]] = id;
+        }
+        vertex_num += new_vertices;
+        meshlet.index_num += 3;
+        i += 3;
+      }
+      compute_bounds(meshlet, source.indices, positions, stride);
+      meshlets.push_back(meshlet);
+    }
+    level.meshlet_num = meshlets.size() - level.first_meshlet;
+  }
+
+  if (!source.lods.empty()) {
+    source.lods.swap(levels);
+  }
+  source.meshlets.swap(meshlets);
+}
+
+void frustum_planes(glm::fmat4 const& matrix, glm::fvec4 (&planes)[6]) {
+  // rows of the matrix, combined as in Gribb and Hartmann
+  glm::fvec4 rows[4];
+  for (int r = 0; r < 4; ++r) {
+    rows[r] = glm::fvec4{matrix[0][r], matrix[1][r], matrix[2][r], matrix[3][r]};
+  }
+  for (int axis = 0; axis < 3; ++axis) {
+    planes[axis * 2] = rows[3] + rows[axis];
+    planes[axis * 2 + 1] = rows[3] - rows[axis];
+  }
+  for (auto& plane : planes) {
+    plane /= glm::length(glm::fvec3{plane});
+  }
+}
+
+bool culled(model::meshlet const& meshlet, glm::fvec3 const& camera_position, glm::fvec4 const (&planes)[6]) {
+  glm::fvec4 center{meshlet.center, 1.0f};
+  for (auto const& plane : planes) {
+    if (glm::dot(plane, center) < -meshlet.radius) {
+      return true;
+    }
+  }
+  // cones wider than a hemisphere always contain a visible direction
+  if (meshlet.cone_cutoff <= 0.0f) {
+    return false;
+  }
+  glm::fvec3 view = meshlet.center - camera_position;
+  float distance = glm::length(view);
+  if (distance <= meshlet.radius) {
+    return false;
+  }
+  // every triangle faces away if the cone and the view directions to the sphere are separated
+  float cos_view = glm::dot(view, meshlet.cone_axis) / distance;
+  float sin_view = std::sqrt(std::max(0.0f, 1.0f - cos_view * cos_view));
+  float sin_cone = std::sqrt(std::max(0.0f, 1.0f - meshlet.cone_cutoff * meshlet.cone_cutoff));
+  return cos_view * meshlet.cone_cutoff - sin_view * sin_cone >= meshlet.radius / distance;
+}
+
+};
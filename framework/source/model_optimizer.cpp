@@ -0,0 +1,329 @@
+#include "model_optimizer.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace model_optimizer {
+
+// triangles adjacent to each vertex, in compressed row format
+struct adjacency {
+  std::vector<std::size_t> offsets;
+  std::vector<std::size_t> triangles;
+};
+
+// range of triangles drawn together
+struct cluster {
+  std::size_t begin;
+  std::size_t end;
+  float sort_key;
+};
+
+// optimization reorders the vectors, so mapped storage has to be copied
+static void copy_mapped(model& source) {
+  source.unmap();
+  if (!source.packed_data.empty() || source.index_type != model::INDEX.type) {
+    throw std::logic_error("Model is quantized, optimize it before quantizing");
+  }
+  if (!source.meshlets.empty()) {
+    throw std::logic_error("Model has meshlets, optimize it before building them");
+  }
+}
+
+// index ranges which are reordered separately, the levels of detail or the whole index buffer
+static std::vector<model::lod> levels(model const& source) {
+  if (source.lods.empty()) {
+    return std::vector<model::lod>{model::lod{0, source.indices.size(), 0.0f, 0, 0}};
+  }
+  return source.lods;
+}
+
+static std::size_t vertex_count(std::vector<GLuint> const& indices) {
+  std::size_t count = 0;
+  for (GLuint index : indices) {
+    count = std::max(count, std::size_t(index) + 1);
+  }
+  return count;
+}
+
+static adjacency build_adjacency(std::vector<GLuint> const& indices, std::size_t vertex_num) {
+  adjacency result{std::vector<std::size_t>(vertex_num + 1, 0), std::vector<std::size_t>(indices.size())};
+  for (GLuint index : indices) {
+    ++result.offsets[index + 1];
+  }
+  std::partial_sum(result.offsets.begin(), result.offsets.end(), result.offsets.begin());
+  std::vector<std::size_t> fill(result.offsets.begin(), result.offsets.end() - 1);
+  for (std::size_t i = 0; i < indices.size(); ++i) {
+    result.triangles[fill[indices[i]]++] = i / 3;
+  }
+  return result;
+}
+
+// count cache misses of the triangles in [begin, end), starting with an empty cache
+static std::size_t simulate_fifo(std::vector<GLuint> const& indices, std::size_t begin, std::size_t end,
+                                 std::vector<std::size_t>& stamps, std::size_t& time, unsigned cache_size) {
+  std::size_t misses = 0;
+  for (std::size_t i = begin * 3; i < end * 3; ++i) {
+    // vertex is cached if it was inserted less than cache_size misses ago
+    if (time - stamps[indices[i]] >= cache_size) {
+      stamps[indices[i]] = time++;
+      ++misses;
+    }
+  }
+  return misses;
+}
+
+// indices of the index buffer in [first, first + count), also from quantized or mapped storage
+static std::vector<GLuint> read_indices(model const& source, std::size_t first, std::size_t count) {
+  model::buffer_view index_view = source.index_buffer();
+  if (source.index_type == GL_UNSIGNED_SHORT) {
+    GLushort const* index_ptr = static_cast<GLushort const*>(index_view.ptr) + first;
+    return std::vector<GLuint>(index_ptr, index_ptr + count);
+  }
+  GLuint const* index_ptr = static_cast<GLuint const*>(index_view.ptr) + first;
+  return std::vector<GLuint>(index_ptr, index_ptr + count);
+}
+
+// misses per triangle and per vertex_num vertices
+static cache_statistics simulate(std::vector<GLuint> const& indices, std::size_t vertex_num, unsigned cache_size) {
+  if (indices.empty()) {
+    return cache_statistics{0.0f, 0.0f};
+  }
+  // start time after cache size, so no vertex is initially cached
+  std::size_t time = cache_size;
+  std::vector<std::size_t> stamps(vertex_count(indices), 0);
+  std::size_t misses = simulate_fifo(indices, 0, indices.size() / 3, stamps, time, cache_size);
+  return cache_statistics{float(misses) / float(indices.size() / 3), float(misses) / float(vertex_num)};
+}
+
+cache_statistics analyze_vertex_cache(model const& source, unsigned cache_size) {
+  std::vector<GLuint> indices = read_indices(source, 0, source.index_num());
+  return simulate(indices, std::max(source.vertex_num, vertex_count(indices)), cache_size);
+}
+
+cache_statistics analyze_vertex_cache(model const& source, model::lod const& level, unsigned cache_size) {
+  std::vector<GLuint> indices = read_indices(source, level.first_index, level.index_num);
+  // levels share the vertex buffer, so only count the vertices this one uses
+  std::vector<GLuint> used = indices;
+  std::sort(used.begin(), used.end());
+  return simulate(indices, std::size_t(std::unique(used.begin(), used.end()) - used.begin()), cache_size);
+}
+
+// reorder triangles with tipsify (Sander et al. 2007), stores start of clusters after cache flushes
+static std::vector<GLuint> tipsify(std::vector<GLuint> const& indices, unsigned cache_size, std::vector<std::size_t>& cluster_starts) {
+  std::size_t vertex_num = vertex_count(indices);
+  std::size_t triangle_num = indices.size() / 3;
+  adjacency adjacent = build_adjacency(indices, vertex_num);
+
+  // number of not yet emitted triangles using the vertex
+  std::vector<std::size_t> live(vertex_num);
+  for (std::size_t v = 0; v < vertex_num; ++v) {
+    live[v] = adjacent.offsets[v + 1] - adjacent.offsets[v];
+  }
+  std::vector<std::size_t> cache_time(vertex_num, 0);
+  std::vector<bool> emitted(triangle_num, false);
+  std::vector<GLuint> dead_ends{};
+  std::vector<GLuint> candidates{};
+  std::vector<GLuint> result{};
+  result.reserve(indices.size());
+
+  // time stamp, starts after cache size so no vertex is cached
+  std::size_t stamp = cache_size + 1;
+  std::size_t cursor = 1;
+  long fanning = vertex_num > 0 ? 0 : -1;
+  cluster_starts.assign(1, 0);
+
+  while (fanning >= 0) {
+    candidates.clear();
+    // emit all remaining triangles around the fanning vertex
+    for (std::size_t a = adjacent.offsets[fanning]; a < adjacent.offsets[fanning + 1]; ++a) {
+      std::size_t t = adjacent.triangles[a];
+      if (emitted[t]) continue;
+      for (std::size_t c = 0; c < 3; ++c) {
+        GLuint v = indices[t * 3 + c];
+        result.push_back(v);
+        dead_ends.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        if (stamp - cache_time[v] > cache_size) {
+          cache_time[v] = stamp++;
+        }
+      }
+      emitted[t] = true;
+    }
+
+    // choose next fanning vertex among 1-ring candidates which stay in cache
+    long next = -1;
+    long best_priority = -1;
+    for (GLuint v : candidates) {
+      if (live[v] == 0) continue;
+      long priority = 0;
+      if (stamp - cache_time[v] + 2 * live[v] <= cache_size) {
+        priority = long(stamp - cache_time[v]);
+      }
+      if (priority > best_priority) {
+        best_priority = priority;
+        next = long(v);
+      }
+    }
+
+    if (next == -1) {
+      // dead end, continue with recently used vertex or in input order
+      while (!dead_ends.empty()) {
+        GLuint v = dead_ends.back();
+        dead_ends.pop_back();
+        if (live[v] > 0) {
+          next = long(v);
+          break;
+        }
+      }
+      while (next == -1 && cursor < vertex_num) {
+        if (live[cursor] > 0) {
+          next = long(cursor);
+        }
+        ++cursor;
+      }
+      // cache is effectively flushed here, start new cluster
+      if (next != -1 && result.size() / 3 > cluster_starts.back()) {
+        cluster_starts.push_back(result.size() / 3);
+      }
+    }
+    fanning = next;
+  }
+  return result;
+}
+
+void optimize_vertex_cache(model& source, unsigned cache_size) {
+  copy_mapped(source);
+  for (auto const& level : levels(source)) {
+    auto first = source.indices.begin() + std::ptrdiff_t(level.first_index);
+    std::vector<std::size_t> cluster_starts{};
+    std::vector<GLuint> indices = tipsify(std::vector<GLuint>(first, first + std::ptrdiff_t(level.index_num)), cache_size, cluster_starts);
+    std::copy(indices.begin(), indices.end(), first);
+  }
+}
+
+// reorder the triangles of one level with tipsify and sort the resulting clusters
+static std::vector<GLuint> overdraw_order(model const& source, std::vector<GLuint> const& level,
+                                          unsigned cache_size, float threshold) {
+  if (level.empty()) {
+    return level;
+  }
+  std::vector<std::size_t> hard_starts{};
+  std::vector<GLuint> indices = tipsify(level, cache_size, hard_starts);
+  std::size_t triangle_num = indices.size() / 3;
+  hard_starts.push_back(triangle_num);
+
+  std::size_t vertex_num = vertex_count(indices);
+  std::vector<std::size_t> stamps(vertex_num, 0);
+  std::size_t time = cache_size;
+  float global_acmr = float(simulate_fifo(indices, 0, triangle_num, stamps, time, cache_size)) / float(triangle_num);
+
+  // split clusters further where their acmr already reached the target
+  std::vector<cluster> clusters{};
+  for (std::size_t h = 0; h + 1 < hard_starts.size(); ++h) {
+    std::size_t begin = hard_starts[h];
+    std::size_t misses = 0;
+    // flush cache at cluster start
+    time += cache_size;
+    for (std::size_t t = begin; t < hard_starts[h + 1]; ++t) {
+      misses += simulate_fifo(indices, t, t + 1, stamps, time, cache_size);
+      if (float(misses) / float(t + 1 - begin) <= threshold * global_acmr && t + 1 < hard_starts[h + 1]) {
+        clusters.push_back(cluster{begin, t + 1, 0.0f});
+        begin = t + 1;
+        misses = 0;
+        time += cache_size;
+      }
+    }
+    clusters.push_back(cluster{begin, hard_starts[h + 1], 0.0f});
+  }
+
+  // sort clusters by how much they face away from the mesh center
+  std::size_t stride = std::size_t(source.vertex_bytes) / sizeof(GLfloat);
+  std::size_t position_offset = std::size_t(uintptr_t(source.offsets.at(model::POSITION).offset)) / sizeof(GLfloat);
+  auto position = [&](GLuint v) {
+    GLfloat const* p = &source.data[v * stride + position_offset];
+    return glm::fvec3{p[0], p[1], p[2]};
+  };
+  // center of the vertices used by the level
+  std::vector<bool> used(vertex_num, false);
+  glm::fvec3 mesh_center{0.0f};
+  std::size_t used_num = 0;
+  for (GLuint index : indices) {
+    if (!used[index]) {
+      used[index] = true;
+      mesh_center += position(index);
+      ++used_num;
+    }
+  }
+  mesh_center /= float(used_num);
+
+  for (auto& part : clusters) {
+    glm::fvec3 center{0.0f};
+    glm::fvec3 normal{0.0f};
+    float area = 0.0f;
+    for (std::size_t t = part.begin; t < part.end; ++t) {
+      glm::fvec3 p0 = position(indices[t * 3]);
+      glm::fvec3 p1 = position(indices[t * 3 + 1]);
+      glm::fvec3 p2 = position(indices[t * 3 + 2]);
+      // length of cross product is twice the triangle area
+      glm::fvec3 face_normal = glm::cross(p1 - p0, p2 - p0);
+      float face_area = glm::length(face_normal);
+      center += (p0 + p1 + p2) * (face_area / 3.0f);
+      normal += face_normal;
+      area += face_area;
+    }
+    if (area > 0.0f && glm::length(normal) > 0.0f) {
+      part.sort_key = glm::dot(center / area - mesh_center, glm::normalize(normal));
+    }
+  }
+  std::stable_sort(clusters.begin(), clusters.end(), [](cluster const& a, cluster const& b) {
+    return a.sort_key > b.sort_key;
+  });
+
+  std::vector<GLuint> result{};
+  result.reserve(indices.size());
+  for (auto const& part : clusters) {
+    result.insert(result.end(), indices.begin() + std::ptrdiff_t(part.begin * 3), indices.begin() + std::ptrdiff_t(part.end * 3));
+  }
+  return result;
+}
+
+void optimize_overdraw(model& source, unsigned cache_size, float threshold) {
+  copy_mapped(source);
+  for (auto const& level : levels(source)) {
+    auto first = source.indices.begin() + std::ptrdiff_t(level.first_index);
+    std::vector<GLuint> indices = overdraw_order(source, std::vector<GLuint>(first, first + std::ptrdiff_t(level.index_num)), cache_size, threshold);
+    std::copy(indices.begin(), indices.end(), first);
+  }
+}
+
+void optimize_vertex_fetch(model& source) {
+  copy_mapped(source);
+  std::size_t stride = std::size_t(source.vertex_bytes) / sizeof(GLfloat);
+  if (stride == 0) {
+    return;
+  }
+  std::size_t vertex_num = source.data.size() / stride;
+  std::vector<GLuint> remap(vertex_num, std::numeric_limits<GLuint>::max());
+  std::vector<GLfloat> data{};
+  data.reserve(source.data.size());
+
+  GLuint next = 0;
+  for (auto& index : source.indices) {
+    if (remap[index] == std::numeric_limits<GLuint>::max()) {
+      remap[index] = next++;
+      data.insert(data.end(), source.data.begin() + std::ptrdiff_t(index * stride), source.data.begin() + std::ptrdiff_t((index + 1) * stride));
+    }
+    index = remap[index];
+  }
+  source.data.swap(data);
+  source.vertex_num = next;
+}
+
+};
@@ -0,0 +1,163 @@
+#include "model_quantizer.hpp"
+
+#include <glbinding/gl/enum.h>
+#include <glm/gtc/packing.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace model_quantizer {
+
+// packed attributes start at multiples of 4 bytes
+static GLsizei const ALIGNMENT = 4;
+
+static GLsizei align(GLsizei bytes) {
+  return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+static float sign_not_zero(float value) {
+  return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+void encode_octahedral(GLfloat const* vector, GLfloat* encoded) {
+  float length = std::abs(vector[0]) + std::abs(vector[1]) + std::abs(vector[2]);
+  if (length == 0.0f) {
+    encoded[0] = 0.0f;
+    encoded[1] = 0.0f;
+    return;
+  }
+  float x = vector[0] / length;
+  float y = vector[1] / length;
+  // fold lower hemisphere over the diagonals
+  if (vector[2] < 0.0f) {
+    float folded_x = (1.0f - std::abs(y)) * sign_not_zero(x);
+    y = (1.0f - std::abs(x)) * sign_not_zero(y);
+    x = folded_x;
+  }
+  encoded[0] = x;
+  encoded[1] = y;
+}
+
+void decode_octahedral(GLfloat const* encoded, GLfloat* vector) {
+  float x = encoded[0];
+  float y = encoded[1];
+  float z = 1.0f - std::abs(x) - std::abs(y);
+  float t = std::max(-z, 0.0f);
+  x += x >= 0.0f ? -t : t;
+  y += y >= 0.0f ? -t : t;
+  float length = std::sqrt(x * x + y * y + z * z);
+  vector[0] = x / length;
+  vector[1] = y / length;
+  vector[2] = z / length;
+}
+
+// whether all components of the attribute lie inside [min, max]
+static bool in_range(GLfloat const* vertices, std::size_t vertex_num, std::size_t stride, std::size_t offset,
+                     GLint components, float min, float max) {
+  for (std::size_t v = 0; v < vertex_num; ++v) {
+    for (GLint c = 0; c < components; ++c) {
+      float value = vertices[v * stride + offset + std::size_t(c)];
+      if (!(value >= min && value <= max)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// packed representation of a float attribute
+static model::attribute packed_attribute(model::attribute const& attribute, GLfloat const* vertices, std::size_t vertex_num, std::size_t stride) {
+  std::size_t offset = std::size_t(uintptr_t(attribute.offset)) / sizeof(GLfloat);
+  if (attribute.flag == model::NORMAL || attribute.flag == model::TANGENT || attribute.flag == model::BITANGENT) {
+    return model::attribute{attribute.flag, sizeof(GLshort), 2, GL_SHORT, GL_TRUE};
+  }
+  else if (attribute.flag == model::POSITION && in_range(vertices, vertex_num, stride, offset, attribute.components, -1.0f, 1.0f)) {
+    return model::attribute{attribute.flag, sizeof(GLshort), attribute.components, GL_SHORT, GL_TRUE};
+  }
+  else if (attribute.flag == model::TEXCOORD && in_range(vertices, vertex_num, stride, offset, attribute.components, 0.0f, 1.0f)) {
+    return model::attribute{attribute.flag, sizeof(GLushort), attribute.components, GL_UNSIGNED_SHORT, GL_TRUE};
+  }
+  return model::attribute{attribute.flag, sizeof(GLushort), attribute.components, GL_HALF_FLOAT, GL_FALSE};
+}
+
+static void pack_attribute(model::attribute const& source, model::attribute const& packed, GLfloat const* input, std::uint8_t* output) {
+  GLfloat const* value = input + uintptr_t(source.offset) / sizeof(GLfloat);
+  std::uint16_t* target = reinterpret_cast<std::uint16_t*>(output + uintptr_t(packed.offset));
+  if (source.components != packed.components) {
+    GLfloat encoded[2];
+    encode_octahedral(value, encoded);
+    target[0] = glm::packSnorm1x16(encoded[0]);
+    target[1] = glm::packSnorm1x16(encoded[1]);
+    return;
+  }
+  for (GLint c = 0; c < packed.components; ++c) {
+    if (packed.type == GL_SHORT) {
+      target[c] = glm::packSnorm1x16(value[c]);
+    }
+    else if (packed.type == GL_UNSIGNED_SHORT) {
+      target[c] = glm::packUnorm1x16(value[c]);
+    }
+    else {
+      target[c] = glm::packHalf1x16(value[c]);
+    }
+  }
+}
+
+void quantize(model& source) {
+  if (!source.packed_data.empty() || source.index_type != model::INDEX.type) {
+    throw std::logic_error("Model is already quantized");
+  }
+  model::buffer_view vertices = source.vertex_buffer();
+  model::buffer_view indices = source.index_buffer();
+  GLfloat const* vertex_ptr = static_cast<GLfloat const*>(vertices.ptr);
+  GLuint const* index_ptr = static_cast<GLuint const*>(indices.ptr);
+  std::size_t stride = std::size_t(source.vertex_bytes) / sizeof(GLfloat);
+  std::size_t vertex_num = stride > 0 ? vertices.bytes / std::size_t(source.vertex_bytes) : 0;
+  std::size_t index_num = indices.bytes / sizeof(GLuint);
+
+  // compute packed layout
+  std::map<model::attrib_flag_t, model::attribute> offsets{};
+  GLsizei vertex_bytes = 0;
+  for (auto const& pair : source.offsets) {
+    model::attribute packed = packed_attribute(pair.second, vertex_ptr, vertex_num, stride);
+    packed.offset = (GLvoid*)uintptr_t(vertex_bytes);
+    offsets.insert(std::pair<model::attrib_flag_t, model::attribute>{pair.first, packed});
+    vertex_bytes += align(packed.size * packed.components);
+  }
+
+  std::vector<std::uint8_t> packed_data(vertex_num * std::size_t(vertex_bytes), 0);
+  for (std::size_t v = 0; v < vertex_num; ++v) {
+    for (auto const& pair : source.offsets) {
+      pack_attribute(pair.second, offsets.at(pair.first), vertex_ptr + v * stride, packed_data.data() + v * std::size_t(vertex_bytes));
+    }
+  }
+
+  // 16 bit indices address up to 65536 vertices
+  std::vector<GLuint> index_data(index_ptr, index_ptr + index_num);
+  std::vector<GLushort> packed_indices{};
+  bool short_indices = vertex_num <= std::size_t(std::numeric_limits<GLushort>::max()) + 1;
+  for (GLuint index : index_data) {
+    short_indices = short_indices && index <= std::numeric_limits<GLushort>::max();
+  }
+  if (short_indices) {
+    packed_indices.assign(index_data.begin(), index_data.end());
+    index_data.clear();
+  }
+
+  source.packed_data.swap(packed_data);
+  source.packed_indices.swap(packed_indices);
+  source.indices.swap(index_data);
+  source.index_type = short_indices ? GL_UNSIGNED_SHORT : model::INDEX.type;
+  source.offsets = offsets;
+  source.vertex_bytes = vertex_bytes;
+  source.vertex_num = vertex_num;
+  source.data.clear();
+  source.mapping.reset();
+  source.mapped_data = model::buffer_view{nullptr, 0};
+  source.mapped_indices = model::buffer_view{nullptr, 0};
+}
+
+};
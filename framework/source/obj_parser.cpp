@@ -0,0 +1,500 @@
+#include "obj_parser.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace obj_parser {
+
+// minimal number of bytes per parsing thread
+static std::size_t const MIN_CHUNK_BYTES = 1 << 16;
+
+// zero-based indices of one face corner, -1 if not given
+struct vertex_index {
+  int v;
+  int vt;
+  int vn;
+
+  bool operator==(vertex_index const& other) const {
+    return v == other.v && vt == other.vt && vn == other.vn;
+  }
+};
+
+struct vertex_index_hash {
+  std::size_t operator()(vertex_index const& i) const {
+    std::uint64_t h = std::uint64_t(std::uint32_t(i.v)) * 0x9E3779B97F4A7C15ull;
+    h ^= (std::uint64_t(std::uint32_t(i.vt)) + 0x7F4A7C15ull + (h << 6) + (h >> 2)) * 0xBF58476D1CE4E5B9ull;
+    h ^= (std::uint64_t(std::uint32_t(i.vn)) + 0x94D049BBull + (h << 6) + (h >> 2)) * 0x94D049BB133111EBull;
+    return std::size_t(h ^ (h >> 31));
+  }
+};
+
+// flags marking relative corner indices, resolved after merging chunks
+enum relative_flag : std::uint8_t {
+  RELATIVE_V  = 1 << 0,
+  RELATIVE_VT = 1 << 1,
+  RELATIVE_VN = 1 << 2
+};
+
+// group, object or material statement, ends the current shape
+struct group_event {
+  // number of chunk faces preceding the statement
+  std::size_t face;
+  // whether the statement changes the shape name
+  bool renames;
+  std::string name;
+};
+
+// parsing result of one newline-aligned part of the file
+struct chunk {
+  std::vector<float> v;
+  std::vector<float> vn;
+  std::vector<float> vt;
+  std::vector<vertex_index> corners;
+  std::vector<std::uint8_t> relative;
+  // end of each face in corners
+  std::vector<std::size_t> face_ends;
+  std::vector<group_event> events;
+};
+
+// consecutive faces of one chunk, belonging to the same shape
+struct segment {
+  chunk const* source;
+  std::size_t face_begin;
+  std::size_t face_end;
+  // deduplicated corners in order of appearance
+  std::vector<vertex_index> unique;
+  // index into unique for each corner of a triangulated face
+  std::vector<std::uint32_t> corner_vertices;
+  // index of first triangle in shape
+  std::size_t triangle_offset;
+};
+
+struct shape_info {
+  std::string name;
+  std::vector<std::size_t> segments;
+};
+
+static double const POWERS_OF_TEN[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool is_space(char c) {
+  return c == ' ' || c == '\t';
+}
+
+static inline bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static inline char const* skip_space(char const* p, char const* end) {
+  while (p < end && is_space(*p)) ++p;
+  return p;
+}
+
+static inline char const* token_end(char const* p, char const* end) {
+  while (p < end && !is_space(*p) && *p != '\r') ++p;
+  return p;
+}
+
+// locale independent float parsing, returns false on malformed input
+static bool parse_double(char const* p, char const* end, double& result) {
+  bool negative = false;
+  if (p < end && (*p == '+' || *p == '-')) {
+    negative = *p == '-';
+    ++p;
+  }
+  std::uint64_t mantissa = 0;
+  int exponent = 0;
+  int digits = 0;
+  // integer part, digits beyond precision only scale
+  for (; p < end && is_digit(*p); ++p, ++digits) {
+    if (mantissa < 1000000000000000000ull) {
+      mantissa = mantissa * 10 + std::uint64_t(*p - '0');
+    }
+    else {
+      ++exponent;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && is_digit(*p); ++p, ++digits) {
+      if (mantissa < 1000000000000000000ull) {
+        mantissa = mantissa * 10 + std::uint64_t(*p - '0');
+        --exponent;
+      }
+    }
+  }
+  if (digits == 0) {
+    return false;
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negative_exp = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+      negative_exp = *p == '-';
+      ++p;
+    }
+    if (p == end || !is_digit(*p)) {
+      return false;
+    }
+    int exp_value = 0;
+    for (; p < end && is_digit(*p); ++p) {
+      if (exp_value < 10000) exp_value = exp_value * 10 + (*p - '0');
+    }
+    exponent += negative_exp ? -exp_value : exp_value;
+  }
+
+  double value = double(mantissa);
+  // exact for mantissas below 2^53 and small exponents
+  if (exponent >= 0 && exponent <= 22) {
+    value *= POWERS_OF_TEN[exponent];
+  }
+  else if (exponent < 0 && exponent >= -22) {
+    value /= POWERS_OF_TEN[-exponent];
+  }
+  else {
+    value *= std::pow(10.0, double(exponent));
+  }
+  result = negative ? -value : value;
+  return true;
+}
+
+// parse whitespace separated float, 0 if malformed
+static inline float parse_float(char const*& p, char const* end) {
+  p = skip_space(p, end);
+  char const* last = token_end(p, end);
+  double value = 0.0;
+  parse_double(p, last, value);
+  p = last;
+  return float(value);
+}
+
+// parse index like atoi
+static inline int parse_int(char const* p, char const* end) {
+  bool negative = false;
+  if (p < end && (*p == '+' || *p == '-')) {
+    negative = *p == '-';
+    ++p;
+  }
+  int value = 0;
+  for (; p < end && is_digit(*p); ++p) {
+    value = value * 10 + (*p - '0');
+  }
+  return negative ? -value : value;
+}
+
+static inline char const* index_end(char const* p, char const* end) {
+  while (p < end && *p != '/' && !is_space(*p) && *p != '\r') ++p;
+  return p;
+}
+
+// make index zero-based, relative indices are stored relative to chunk-local count
+static inline int fix_index(int idx, std::size_t local_num, std::uint8_t& relative, std::uint8_t flag) {
+  if (idx > 0) return idx - 1;
+  if (idx == 0) return 0;
+  relative |= flag;
+  return int(local_num) + idx;
+}
+
+// parse corner formats i, i/j/k, i//k and i/j
+static vertex_index parse_corner(char const*& p, char const* end, chunk const& part, std::uint8_t& relative) {
+  vertex_index index{-1, -1, -1};
+  relative = 0;
+
+  index.v = fix_index(parse_int(p, end), part.v.size() / 3, relative, RELATIVE_V);
+  p = index_end(p, end);
+  if (p == end || *p != '/') {
+    return index;
+  }
+  ++p;
+  // i//k
+  if (p < end && *p == '/') {
+    ++p;
+    index.vn = fix_index(parse_int(p, end), part.vn.size() / 3, relative, RELATIVE_VN);
+    p = index_end(p, end);
+    return index;
+  }
+  // i/j/k or i/j
+  index.vt = fix_index(parse_int(p, end), part.vt.size() / 2, relative, RELATIVE_VT);
+  p = index_end(p, end);
+  if (p == end || *p != '/') {
+    return index;
+  }
+  ++p;
+  index.vn = fix_index(parse_int(p, end), part.vn.size() / 3, relative, RELATIVE_VN);
+  p = index_end(p, end);
+  return index;
+}
+
+static inline bool starts_with(char const* p, char const* end, char const* command, std::size_t length) {
+  return std::size_t(end - p) > length && std::strncmp(p, command, length) == 0 && is_space(p[length]);
+}
+
+static void parse_chunk(char const* begin, char const* end, chunk& part) {
+  char const* line = begin;
+  while (line < end) {
+    char const* line_end = static_cast<char const*>(std::memchr(line, '\n', std::size_t(end - line)));
+    if (!line_end) line_end = end;
+    char const* next_line = line_end < end ? line_end + 1 : end;
+    // trim carriage return
+    if (line_end > line && line_end[-1] == '\r') --line_end;
+
+    char const* p = skip_space(line, line_end);
+    line = next_line;
+    if (p == line_end || *p == '#') {
+      continue;
+    }
+
+    if (starts_with(p, line_end, "v", 1)) {
+      p += 2;
+      part.v.push_back(parse_float(p, line_end));
+      part.v.push_back(parse_float(p, line_end));
+      part.v.push_back(parse_float(p, line_end));
+    }
+    else if (starts_with(p, line_end, "vn", 2)) {
+      p += 3;
+      part.vn.push_back(parse_float(p, line_end));
+      part.vn.push_back(parse_float(p, line_end));
+      part.vn.push_back(parse_float(p, line_end));
+    }
+    else if (starts_with(p, line_end, "vt", 2)) {
+      p += 3;
+      part.vt.push_back(parse_float(p, line_end));
+      part.vt.push_back(parse_float(p, line_end));
+    }
+    else if (starts_with(p, line_end, "f", 1)) {
+      p = skip_space(p + 2, line_end);
+      while (p < line_end && *p != '\r') {
+        std::uint8_t relative = 0;
+        part.corners.push_back(parse_corner(p, line_end, part, relative));
+        part.relative.push_back(relative);
+        while (p < line_end && (is_space(*p) || *p == '\r')) ++p;
+      }
+      part.face_ends.push_back(part.corners.size());
+    }
+    else if (starts_with(p, line_end, "usemtl", 6)) {
+      // materials are not loaded, so only the shape ends
+      part.events.push_back(group_event{part.face_ends.size(), false, ""});
+    }
+    else if (starts_with(p, line_end, "g", 1)) {
+      // first name after the tag is used
+      char const* name = skip_space(p + 2, line_end);
+      part.events.push_back(group_event{part.face_ends.size(), true, std::string(name, token_end(name, line_end))});
+    }
+    else if (starts_with(p, line_end, "o", 1)) {
+      char const* name = skip_space(p + 2, line_end);
+      char const* name_end = name;
+      while (name_end < line_end && !std::isspace(static_cast<unsigned char>(*name_end))) ++name_end;
+      part.events.push_back(group_event{part.face_ends.size(), true, std::string(name, name_end)});
+    }
+    // mtllib and unknown statements are ignored
+  }
+}
+
+// deduplicate corners of the segment faces in order of appearance
+static void deduplicate(segment& seg) {
+  chunk const& part = *seg.source;
+  std::size_t corner_begin = seg.face_begin > 0 ? part.face_ends[seg.face_begin - 1] : 0;
+  std::size_t corner_end = seg.face_end > 0 ? part.face_ends[seg.face_end - 1] : 0;
+
+  std::unordered_map<vertex_index, std::uint32_t, vertex_index_hash> cache{};
+  cache.reserve(corner_end - corner_begin);
+  seg.corner_vertices.reserve(corner_end - corner_begin);
+
+  std::size_t face_start = corner_begin;
+  for (std::size_t f = seg.face_begin; f < seg.face_end; ++f) {
+    std::size_t face_stop = part.face_ends[f];
+    // faces without triangles create no vertices
+    if (face_stop - face_start >= 3) {
+      for (std::size_t c = face_start; c < face_stop; ++c) {
+        auto inserted = cache.insert(std::make_pair(part.corners[c], std::uint32_t(seg.unique.size())));
+        if (inserted.second) {
+          seg.unique.push_back(part.corners[c]);
+        }
+        seg.corner_vertices.push_back(inserted.first->second);
+      }
+    }
+    face_start = face_stop;
+  }
+}
+
+std::vector<tinyobj::shape_t> parse(char const* text, std::size_t length) {
+  // split at newlines so every chunk contains whole lines
+  std::size_t chunk_num = parallel_chunks(length, MIN_CHUNK_BYTES);
+  std::vector<std::size_t> bounds(chunk_num + 1, length);
+  bounds[0] = 0;
+  for (std::size_t i = 1; i < chunk_num; ++i) {
+    std::size_t pos = std::max(bounds[i - 1], length / chunk_num * i);
+    void const* newline = pos < length ? std::memchr(text + pos, '\n', length - pos) : nullptr;
+    bounds[i] = newline ? std::size_t(static_cast<char const*>(newline) - text) + 1 : length;
+  }
+
+  std::vector<chunk> parts(chunk_num);
+  parallel_for(chunk_num, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      parse_chunk(text + bounds[i], text + bounds[i + 1], parts[i]);
+    }
+  });
+
+  // merge attribute arrays and resolve relative indices
+  std::vector<std::size_t> v_offsets(chunk_num + 1, 0);
+  std::vector<std::size_t> vn_offsets(chunk_num + 1, 0);
+  std::vector<std::size_t> vt_offsets(chunk_num + 1, 0);
+  for (std::size_t i = 0; i < chunk_num; ++i) {
+    v_offsets[i + 1] = v_offsets[i] + parts[i].v.size();
+    vn_offsets[i + 1] = vn_offsets[i] + parts[i].vn.size();
+    vt_offsets[i + 1] = vt_offsets[i] + parts[i].vt.size();
+  }
+  std::vector<float> v(v_offsets.back());
+  std::vector<float> vn(vn_offsets.back());
+  std::vector<float> vt(vt_offsets.back());
+  parallel_for(chunk_num, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      chunk& part = parts[i];
+      std::copy(part.v.begin(), part.v.end(), v.begin() + std::ptrdiff_t(v_offsets[i]));
+      std::copy(part.vn.begin(), part.vn.end(), vn.begin() + std::ptrdiff_t(vn_offsets[i]));
+      std::copy(part.vt.begin(), part.vt.end(), vt.begin() + std::ptrdiff_t(vt_offsets[i]));
+      for (std::size_t c = 0; c < part.corners.size(); ++c) {
+        std::uint8_t relative = part.relative[c];
+        if (relative & RELATIVE_V)  part.corners[c].v  += int(v_offsets[i] / 3);
+        if (relative & RELATIVE_VT) part.corners[c].vt += int(vt_offsets[i] / 2);
+        if (relative & RELATIVE_VN) part.corners[c].vn += int(vn_offsets[i] / 3);
+      }
+    }
+  });
+
+  // split faces into shapes at group statements
+  std::vector<segment> segments{};
+  std::vector<shape_info> shape_infos{};
+  shape_info current{"", {}};
+  std::size_t current_faces = 0;
+  auto flush = [&]() {
+    if (current_faces > 0) {
+      shape_infos.push_back(current);
+    }
+    current.segments.clear();
+    current_faces = 0;
+  };
+  for (auto const& part : parts) {
+    std::size_t face_begin = 0;
+    for (std::size_t e = 0; e <= part.events.size(); ++e) {
+      std::size_t face_end = e < part.events.size() ? part.events[e].face : part.face_ends.size();
+      if (face_end > face_begin) {
+        current.segments.push_back(segments.size());
+        segments.push_back(segment{&part, face_begin, face_end, {}, {}, 0});
+        current_faces += face_end - face_begin;
+      }
+      face_begin = face_end;
+      if (e < part.events.size()) {
+        flush();
+        if (part.events[e].renames) {
+          current.name = part.events[e].name;
+        }
+      }
+    }
+  }
+  flush();
+
+  parallel_for(segments.size(), [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      deduplicate(segments[i]);
+    }
+  });
+
+  std::vector<tinyobj::shape_t> shapes(shape_infos.size());
+  for (std::size_t s = 0; s < shape_infos.size(); ++s) {
+    tinyobj::mesh_t& mesh = shapes[s].mesh;
+    shapes[s].name = shape_infos[s].name;
+
+    // merge segment vertices, shape-wide in order of appearance
+    std::vector<vertex_index> unique{};
+    std::unordered_map<vertex_index, std::uint32_t, vertex_index_hash> cache{};
+    std::size_t triangle_num = 0;
+    for (std::size_t seg_index : shape_infos[s].segments) {
+      segment& seg = segments[seg_index];
+      seg.triangle_offset = triangle_num;
+      std::size_t face_start = seg.face_begin > 0 ? seg.source->face_ends[seg.face_begin - 1] : 0;
+      for (std::size_t f = seg.face_begin; f < seg.face_end; ++f) {
+        std::size_t size = seg.source->face_ends[f] - face_start;
+        triangle_num += size >= 3 ? size - 2 : 0;
+        face_start = seg.source->face_ends[f];
+      }
+      // single segment needs no remapping
+      if (shape_infos[s].segments.size() == 1) {
+        unique.swap(seg.unique);
+        break;
+      }
+      std::vector<std::uint32_t> remap(seg.unique.size());
+      for (std::size_t i = 0; i < seg.unique.size(); ++i) {
+        auto inserted = cache.insert(std::make_pair(seg.unique[i], std::uint32_t(unique.size())));
+        if (inserted.second) {
+          unique.push_back(seg.unique[i]);
+        }
+        remap[i] = inserted.first->second;
+      }
+      for (auto& vertex : seg.corner_vertices) {
+        vertex = remap[vertex];
+      }
+    }
+
+    mesh.positions.reserve(unique.size() * 3);
+    for (auto const& index : unique) {
+      if (index.v < 0 || std::size_t(index.v) * 3 + 2 >= v.size()) {
+        throw std::logic_error("obj_parser: vertex index out of range");
+      }
+      mesh.positions.insert(mesh.positions.end(), &v[std::size_t(index.v) * 3], &v[std::size_t(index.v) * 3] + 3);
+      if (index.vn >= 0) {
+        if (std::size_t(index.vn) * 3 + 2 >= vn.size()) {
+          throw std::logic_error("obj_parser: normal index out of range");
+        }
+        mesh.normals.insert(mesh.normals.end(), &vn[std::size_t(index.vn) * 3], &vn[std::size_t(index.vn) * 3] + 3);
+      }
+      if (index.vt >= 0) {
+        if (std::size_t(index.vt) * 2 + 1 >= vt.size()) {
+          throw std::logic_error("obj_parser: texcoord index out of range");
+        }
+        mesh.texcoords.insert(mesh.texcoords.end(), &vt[std::size_t(index.vt) * 2], &vt[std::size_t(index.vt) * 2] + 2);
+      }
+    }
+
+    // triangulate faces as fans
+    mesh.indices.resize(triangle_num * 3);
+    mesh.material_ids.assign(triangle_num, -1);
+    std::vector<std::size_t> const& shape_segments = shape_infos[s].segments;
+    parallel_for(shape_segments.size(), [&](std::size_t, std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        segment const& seg = segments[shape_segments[i]];
+        unsigned* out = mesh.indices.data() + seg.triangle_offset * 3;
+        std::uint32_t const* corner = seg.corner_vertices.data();
+        std::size_t face_start = seg.face_begin > 0 ? seg.source->face_ends[seg.face_begin - 1] : 0;
+        for (std::size_t f = seg.face_begin; f < seg.face_end; ++f) {
+          std::size_t size = seg.source->face_ends[f] - face_start;
+          face_start = seg.source->face_ends[f];
+          if (size < 3) continue;
+          for (std::size_t k = 2; k < size; ++k) {
+            *out++ = corner[0];
+            *out++ = corner[k - 1];
+            *out++ = corner[k];
+          }
+          corner += size;
+        }
+      }
+    });
+  }
+
+  return shapes;
+}
+
+std::vector<tinyobj::shape_t> file(std::string const& path) {
+  mapped_file source{path};
+  return parse(reinterpret_cast<char const*>(source.data()), source.size());
+}
+
+};
@@ -0,0 +1,9 @@
+#include "pixel_data.hpp"
+
+void const* pixel_data::ptr(std::size_t level) const {
+  std::uint8_t const* texels = storage ? storage.get() : pixels.data();
+  if (levels.empty()) {
+    return texels;
+  }
+  return texels + levels.at(level).offset;
+}
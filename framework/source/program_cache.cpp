@@ -0,0 +1,206 @@
+#include "program_cache.hpp"
+#include "mapped_file.hpp"
+#include "utils.hpp"
+
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+#include <glbinding/gl/extension.h>
+#include <glbinding/ContextInfo.h>
+#include <glbinding/Version.h>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+  #include <direct.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+namespace program_cache {
+
+// increase when the layout of the file changes
+static std::uint32_t const VERSION = 1;
+static char const MAGIC[4] = {'P', 'R', 'O', 'G'};
+
+// fixed size file header, followed by the program binary
+struct header {
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t source_hash;
+  // driver specific format of the binary
+  std::uint32_t binary_format;
+  std::uint32_t binary_length;
+  // time to compile and link the program, saved by a hit
+  double build_time;
+};
+
+// fnv-1a
+static std::uint64_t hash_bytes(std::uint64_t hash, void const* data, std::size_t bytes) {
+  std::uint8_t const* begin = static_cast<std::uint8_t const*>(data);
+  for (std::size_t i = 0; i < bytes; ++i) {
+    hash = (hash ^ begin[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+static std::string directory(std::string const& file_path) {
+  std::size_t separator = file_path.find_last_of("/\\");
+  return separator == std::string::npos ? std::string{} : file_path.substr(0, separator + 1);
+}
+
+static bool make_directory(std::string const& path) {
+  struct stat file_stat;
+  if (stat(path.c_str(), &file_stat) == 0) {
+    return true;
+  }
+#ifdef _WIN32
+  return _mkdir(path.c_str()) == 0;
+#else
+  return mkdir(path.c_str(), 0755) == 0;
+#endif
+}
+
+bool supported() {
+  if (glbinding::ContextInfo::version() < glbinding::Version(4, 1)
+   && glbinding::ContextInfo::extensions().count(GLextension::GL_ARB_get_program_binary) == 0) {
+    return false;
+  }
+  // drivers may support the extension without any binary format
+  GLint format_num = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_num);
+  return format_num > 0;
+}
+
+std::uint64_t source_hash(std::vector<std::string> const& sources) {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (auto const& source : sources) {
+    // length separates the sources, so moving text between them changes the hash
+    std::uint64_t length = source.size();
+    hash = hash_bytes(hash, &length, sizeof(length));
+    hash = hash_bytes(hash, source.data(), source.size());
+  }
+  // binaries of other drivers or versions are useless
+  GLenum const names[3] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+  for (GLenum name : names) {
+    char const* value = reinterpret_cast<char const*>(glGetString(name));
+    if (value) {
+      hash = hash_bytes(hash, value, std::strlen(value));
+    }
+  }
+  return hash;
+}
+
+std::string file_path(std::vector<std::string> const& shader_paths, std::vector<std::string> const& defines) {
+  if (shader_paths.empty()) {
+    throw std::invalid_argument("Program cache needs at least one shader");
+  }
+  std::string name{};
+  for (auto const& path : shader_paths) {
+    name += utils::file_name(path) + ".";
+  }
+  // variants get their own file so they do not replace each other
+  for (auto const& define : defines) {
+    name += define + ".";
+  }
+  return directory(shader_paths.front()) + "cache/" + name + "progcache";
+}
+
+GLuint load(std::string const& cache_path, std::uint64_t hash, double& build_time) {
+  std::unique_ptr<mapped_file> file;
+  try {
+    file.reset(new mapped_file{cache_path});
+  }
+  catch (std::exception&) {
+    // no cache yet
+    return 0;
+  }
+  if (file->size() < sizeof(header)) {
+    return 0;
+  }
+  header head;
+  std::memcpy(&head, file->data(), sizeof(header));
+  // reject foreign, outdated or truncated caches
+  if (std::memcmp(head.magic, MAGIC, sizeof(MAGIC)) != 0
+   || head.version != VERSION
+   || head.source_hash != hash
+   || sizeof(header) + head.binary_length > file->size()) {
+    return 0;
+  }
+
+  // unknown formats are an error instead of a rejection
+  GLint format_num = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_num);
+  std::vector<GLint> formats(std::size_t(format_num), 0);
+  glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+  if (std::find(formats.begin(), formats.end(), GLint(head.binary_format)) == formats.end()) {
+    return 0;
+  }
+
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, GLenum(head.binary_format), file->data() + sizeof(header), GLsizei(head.binary_length));
+  // driver rejects binaries of formats it no longer supports
+  GLint success = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (success == 0) {
+    glDeleteProgram(program);
+    return 0;
+  }
+  build_time = head.build_time;
+  return program;
+}
+
+bool store(std::string const& cache_path, std::uint64_t hash, GLuint program, double build_time) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return false;
+  }
+  std::vector<char> binary(std::size_t(length), 0);
+  GLenum format = GL_NONE;
+  glGetProgramBinary(program, length, &length, &format, binary.data());
+
+  header head;
+  std::memset(&head, 0, sizeof(header));
+  std::memcpy(head.magic, MAGIC, sizeof(MAGIC));
+  head.version = VERSION;
+  head.source_hash = hash;
+  head.binary_format = std::uint32_t(format);
+  head.binary_length = std::uint32_t(length);
+  head.build_time = build_time;
+
+  if (!make_directory(directory(cache_path))) {
+    std::cerr << "Cache directory \'" << directory(cache_path) << "\' not writable" << std::endl;
+    return false;
+  }
+  // write to temporary file and rename, so no partial cache is ever mapped
+  std::string temp_path{cache_path + ".tmp"};
+  {
+    std::ofstream ofile(temp_path, std::ios::binary | std::ios::trunc);
+    if (!ofile) {
+      std::cerr << "Cache file \'" << cache_path << "\' not writable" << std::endl;
+      return false;
+    }
+    ofile.write(reinterpret_cast<char const*>(&head), sizeof(header));
+    ofile.write(binary.data(), std::streamsize(head.binary_length));
+    if (!ofile) {
+      std::cerr << "Cache file \'" << cache_path << "\' could not be written" << std::endl;
+      ofile.close();
+      std::remove(temp_path.c_str());
+      return false;
+    }
+  }
+  // rename does not replace existing files on windows
+  std::remove(cache_path.c_str());
+  if (std::rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+};
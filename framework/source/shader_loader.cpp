@@ -1,24 +1,139 @@
 #include "shader_loader.hpp"
+#include "program_cache.hpp"
 #include "utils.hpp"
 
 #include <glbinding/gl/functions.h>
+#include <glbinding/gl/extension.h>
+#include <glbinding/ContextInfo.h>
 // use gl definitions from glbinding 
 using namespace gl;
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <set>
+
 namespace shader_loader {
 
-GLuint shader(std::string const& file_path, GLenum shader_type) {
-  GLuint shader = 0;
-  shader = glCreateShader(shader_type);
+static cache_statistics statistics{0, 0, 0.0};
+
+// milliseconds since start
+static double elapsed(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// whether the driver compiles and links in background threads, checked once as there is only one context
+static bool parallel_compile() {
+  static int supported = -1;
+  if (supported < 0) {
+    std::set<std::string> unknown{};
+    bool arb = glbinding::ContextInfo::extensions(&unknown).count(GLextension::GL_ARB_parallel_shader_compile) > 0;
+    // glbinding does not know the khr extension, it has the same completion query
+    supported = arb || unknown.count("GL_KHR_parallel_shader_compile") > 0;
+    if (arb) {
+      // let the driver choose the number of threads
+      glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+  }
+  return supported > 0;
+}
+
+// directory of file, including the separator
+static std::string directory(std::string const& file_path) {
+  std::size_t separator = file_path.find_last_of("/\\");
+  return separator == std::string::npos ? std::string{} : file_path.substr(0, separator + 1);
+}
+
+// directive making the next line count as line of the source string, glsl before 3.30 counts from the line after it
+static std::string line_directive(std::size_t line, std::size_t source, int version) {
+  return "#line " + std::to_string(version < 330 ? line - 1 : line) + " " + std::to_string(source) + "\n";
+}
+
+// append the lines of the file to the source, replacing include directives with the files not included yet
+static void expand(std::string const& file_path, std::vector<std::string> const* defines, int& version, std::string& source, std::vector<std::string>& files) {
+  std::string text{utils::read_file(file_path)};
+  std::size_t index = files.size();
+  files.push_back(file_path);
+
+  std::size_t line_num = 0;
+  for (std::size_t begin = 0; begin < text.size(); ) {
+    std::size_t end = text.find('\n', begin);
+    end = end == std::string::npos ? text.size() : end + 1;
+    std::string line{text.substr(begin, end - begin)};
+    begin = end;
+    ++line_num;
+
+    std::size_t start = line.find_first_not_of(" \t");
+    std::string directive{start == std::string::npos ? std::string{} : line.substr(start)};
+    if (directive.compare(0, 8, "#include") == 0) {
+      std::size_t name_begin = directive.find('"');
+      std::size_t name_end = directive.find('"', name_begin + 1);
+      if (name_begin == std::string::npos || name_end == std::string::npos) {
+        throw std::invalid_argument("Malformed include in line " + std::to_string(line_num) + " of " + file_path);
+      }
+      std::string include_path{directory(file_path) + directive.substr(name_begin + 1, name_end - name_begin - 1)};
+      // files are only included once, which also breaks cycles
+      if (std::find(files.begin(), files.end(), include_path) == files.end()) {
+        source += line_directive(1, files.size(), version);
+        expand(include_path, nullptr, version, source, files);
+        source += line_directive(line_num + 1, index, version);
+      }
+      else {
+        source += "\n";
+      }
+    }
+    else if (directive.compare(0, 8, "#version") == 0) {
+      version = std::atoi(directive.c_str() + 8);
+      source += line;
+      // defines are only allowed after the version
+      if (defines && !defines->empty()) {
+        for (std::string define : *defines) {
+          std::size_t assignment = define.find('=');
+          if (assignment != std::string::npos) {
+            define[assignment] = ' ';
+          }
+          source += "#define " + define + "\n";
+        }
+        source += line_directive(line_num + 1, index, version);
+      }
+    }
+    else {
+      source += line;
+    }
+  }
+}
+
+std::string preprocess(std::string const& file_path, std::vector<std::string> const& defines, std::vector<std::string>& files) {
+  std::string source{};
+  // shaders without version directive are glsl 1.10
+  int version = 110;
+  expand(file_path, &defines, version, source, files);
+  return source;
+}
+
+// name of the shader in logs, with the numbers of the included files
+static std::string log_name(std::vector<std::string> const& files, std::size_t first) {
+  std::string name{utils::file_name(files[first])};
+  for (std::size_t i = first + 1; i < files.size(); ++i) {
+    name += (i == first + 1 ? " including " : ", ") + std::to_string(i - first) + ": " + utils::file_name(files[i]);
+  }
+  return name;
+}
+
+// start compiling shader, its status is queried when it is needed
+static GLuint start_compile(std::string const& shader_source, GLenum shader_type) {
+  GLuint shader = glCreateShader(shader_type);
 
-  std::string shader_source{utils::read_file(file_path)};
   // glshadersource expects array of c-strings
   const char* shader_chars = shader_source.c_str();
   glShaderSource(shader, 1, &shader_chars, 0);
 
   glCompileShader(shader);
+  return shader;
+}
 
-  // check if compilation was successfull
+// check if compilation was successfull, output the log of the named shader if not
+static bool compiled(GLuint shader, std::string const& name) {
   GLint success = 0;
   glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
   if(success == 0) {
@@ -29,31 +144,14 @@ GLuint shader(std::string const& file_path, GLenum shader_type) {
     GLchar* log_buffer = (GLchar*)malloc(sizeof(GLchar) * log_size);
     glGetShaderInfoLog(shader, log_size, &log_size, log_buffer);
     // output errors
-    utils::output_log(log_buffer, utils::file_name(file_path));
-    // free broken shader
-    glDeleteShader(shader);
+    utils::output_log(log_buffer, name);
     free(log_buffer);
-
-    throw std::logic_error("Compilation of " + file_path);
   }
-
-  return shader;
+  return success != 0;
 }
 
-GLuint program(std::string const& vertex_path, std::string const& fragment_path) {
-  GLuint program = glCreateProgram();
-
-  // load and compile vert and frag shader
-  GLuint vertex_shader = shader(vertex_path, GL_VERTEX_SHADER);
-  GLuint fragment_shader = shader(fragment_path, GL_FRAGMENT_SHADER);
-
-  // attach the shaders to the program
-  glAttachShader(program, vertex_shader);
-  glAttachShader(program, fragment_shader);
-  // link shaders
-  glLinkProgram(program);
-
-  // check if linking was successfull
+// check if linking was successfull, output the log of the program made of the named shaders if not
+static bool linked(GLuint program, std::string const& names) {
   GLint success = 0;
   glGetProgramiv(program, GL_LINK_STATUS, &success);
   if(success == 0) {
@@ -64,66 +162,175 @@ GLuint program(std::string const& vertex_path, std::string const& fragment_path)
     GLchar* log_buffer = (GLchar*)malloc(sizeof(GLchar) * log_size);
     glGetProgramInfoLog(program, log_size, &log_size, log_buffer);
     // output errors
-    utils::output_log(log_buffer, utils::file_name(vertex_path) + " & " + utils::file_name(fragment_path));
-    // free broken program
-    glDeleteProgram(program);
+    utils::output_log(log_buffer, names);
     free(log_buffer);
-
-    throw std::logic_error("Linking of " + vertex_path + " & " + fragment_path);
   }
-  // detach shaders
-  glDetachShader(program, vertex_shader);
-  glDetachShader(program, fragment_shader);
-  // and free them
-  glDeleteShader(vertex_shader);
-  glDeleteShader(fragment_shader);
+  return success != 0;
+}
 
-  return program;
+GLuint shader(std::string const& file_path, GLenum shader_type) {
+  std::vector<std::string> files{};
+  GLuint shader = start_compile(preprocess(file_path, {}, files), shader_type);
+  if (!compiled(shader, log_name(files, 0))) {
+    // free broken shader
+    glDeleteShader(shader);
+    throw std::logic_error("Compilation of " + file_path);
+  }
+  return shader;
 }
 
-GLuint program(std::string const& vertex_path, std::string const& geometry_path, std::string const& fragment_path) {
-  GLuint program = glCreateProgram();
+program_build build_program(std::vector<std::string> const& paths, std::vector<GLenum> const& types,
+                            std::vector<std::string> const& defines) {
+  program_build build{paths, {}, {}, {}, 0, program_cache::supported(), 0, {}, 0.0};
+  std::vector<std::string> sources{};
+  for (auto const& path : paths) {
+    std::size_t first = build.files.size();
+    // each shader numbers its included files from 1
+    std::vector<std::string> files{};
+    sources.push_back(preprocess(path, defines, files));
+    build.files.insert(build.files.end(), files.begin(), files.end());
+    build.names.push_back(log_name(build.files, first));
+  }
 
-  // load and compile vert and frag shader
-  GLuint vertex_shader = shader(vertex_path, GL_VERTEX_SHADER);
-  GLuint geometry_shader = shader(geometry_path, GL_GEOMETRY_SHADER);
-  GLuint fragment_shader = shader(fragment_path, GL_FRAGMENT_SHADER);
+  if (build.cached) {
+    build.hash = program_cache::source_hash(sources);
+    build.cache_path = program_cache::file_path(paths, defines);
+    std::chrono::steady_clock::time_point load_start = std::chrono::steady_clock::now();
+    double build_time = 0.0;
+    build.program = program_cache::load(build.cache_path, build.hash, build_time);
+    if (build.program != 0) {
+      ++statistics.hits;
+      statistics.saved_time += std::max(0.0, build_time - elapsed(load_start));
+      return build;
+    }
+    ++statistics.misses;
+  }
 
+  // background threads are enabled before the first compilation
+  parallel_compile();
+  std::chrono::steady_clock::time_point compile_start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    build.shaders.push_back(start_compile(sources[i], types[i]));
+  }
+  build.program = glCreateProgram();
+  // binary can only be retrieved when requested before linking
+  if (build.cached) {
+    glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 1);
+  }
   // attach the shaders to the program
-  glAttachShader(program, vertex_shader);
-  glAttachShader(program, geometry_shader);
-  glAttachShader(program, fragment_shader);
-  // link shaders
-  glLinkProgram(program);
+  for (GLuint shader : build.shaders) {
+    glAttachShader(build.program, shader);
+  }
+  // link shaders, waits for the compilation in the background
+  glLinkProgram(build.program);
+  build.build_time += elapsed(compile_start);
+  return build;
+}
 
-  // check if linking was successfull
-  GLint success = 0;
-  glGetProgramiv(program, GL_LINK_STATUS, &success);
-  if(success == 0) {
-    // get log length
-    GLint log_size = 0;
-    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_size);
-    // get log
-    GLchar* log_buffer = (GLchar*)malloc(sizeof(GLchar) * log_size);
-    glGetProgramInfoLog(program, log_size, &log_size, log_buffer);
-    // output errors
-    utils::output_log(log_buffer, utils::file_name(vertex_path) + " & " + utils::file_name(geometry_path) + " & " + utils::file_name(fragment_path));
-    // free broken program
-    glDeleteProgram(program);
-    free(log_buffer);
+bool program_ready(program_build const& build) {
+  if (build.shaders.empty() || !parallel_compile()) {
+    return true;
+  }
+  GLint ready = 0;
+  glGetProgramiv(build.program, GL_COMPLETION_STATUS_ARB, &ready);
+  return ready != 0;
+}
 
-    throw std::logic_error("Linking of " + vertex_path + " & " + geometry_path + " & " + fragment_path);
+GLuint finish_program(program_build& build) {
+  // loaded from cache
+  if (build.shaders.empty()) {
+    GLuint program = build.program;
+    build.program = 0;
+    return program;
   }
-  // detach shaders
-  glDetachShader(program, vertex_shader);
-  glDetachShader(program, geometry_shader);
-  glDetachShader(program, fragment_shader);
-  // and free them
-  glDeleteShader(vertex_shader);
-  glDeleteShader(geometry_shader);
-  glDeleteShader(fragment_shader);
 
+  // status queries block until the driver finished compiling and linking
+  std::chrono::steady_clock::time_point status_start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < build.shaders.size(); ++i) {
+    if (!compiled(build.shaders[i], build.names[i])) {
+      std::string path{build.paths[i]};
+      cancel_program(build);
+      throw std::logic_error("Compilation of " + path);
+    }
+  }
+  std::string names{};
+  std::string linked_paths{};
+  for (auto const& path : build.paths) {
+    names += (names.empty() ? "" : " & ") + utils::file_name(path);
+    linked_paths += (linked_paths.empty() ? "" : " & ") + path;
+  }
+  if (!linked(build.program, names)) {
+    // free broken program
+    cancel_program(build);
+    throw std::logic_error("Linking of " + linked_paths);
+  }
+  for (GLuint shader : build.shaders) {
+    // detach shaders
+    glDetachShader(build.program, shader);
+    // and free them
+    glDeleteShader(shader);
+  }
+  build.shaders.clear();
+  build.build_time += elapsed(status_start);
+
+  if (build.cached) {
+    // failing to write the cache only costs time on the next run
+    program_cache::store(build.cache_path, build.hash, build.program, build.build_time);
+  }
+  GLuint program = build.program;
+  build.program = 0;
   return program;
 }
 
-};
\ No newline at end of file
+void cancel_program(program_build& build) {
+  // attached shaders are deleted with the program
+  for (GLuint shader : build.shaders) {
+    glDeleteShader(shader);
+  }
+  build.shaders.clear();
+  glDeleteProgram(build.program);
+  build.program = 0;
+}
+
+GLuint program(std::string const& vertex_path, std::string const& fragment_path) {
+  program_build build{build_program({vertex_path, fragment_path}, {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER})};
+  return finish_program(build);
+}
+
+GLuint program(std::string const& vertex_path, std::string const& geometry_path, std::string const& fragment_path) {
+  program_build build{build_program({vertex_path, geometry_path, fragment_path}, {GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER})};
+  return finish_program(build);
+}
+
+cache_statistics const& cache_stats() {
+  return statistics;
+}
+
+std::map<std::string, GLint> uniform_locations(GLuint program) {
+  std::map<std::string, GLint> locations{};
+  GLint uniform_num = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniform_num);
+  GLint max_length = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+  std::vector<GLchar> name_buffer(std::size_t(std::max(max_length, 1)), 0);
+
+  for (GLint i = 0; i < uniform_num; ++i) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = GL_NONE;
+    glGetActiveUniform(program, GLuint(i), GLsizei(name_buffer.size()), &length, &size, &type, name_buffer.data());
+    std::string name{name_buffer.data(), std::size_t(length)};
+    GLint location = glGetUniformLocation(program, name.c_str());
+    if (location < 0) {
+      continue;
+    }
+    // arrays are reported by their first element
+    if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+      name.resize(name.size() - 3);
+    }
+    locations[name] = location;
+  }
+  return locations;
+}
+
+};
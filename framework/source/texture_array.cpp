@@ -0,0 +1,99 @@
+#include "texture_array.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace texture_array {
+
+// size of a level in copy units, texels or 4x4 blocks of compressed images
+static void unit_grid(pixel_data const& image, std::size_t width, std::size_t height, std::size_t& grid_width, std::size_t& grid_height) {
+  bool blocks = image.compression != GL_NONE;
+  grid_width = blocks ? (width + 3) / 4 : width;
+  grid_height = blocks ? (height + 3) / 4 : height;
+}
+
+pixel_data pack(std::vector<pixel_data const*> const& images, std::vector<layer>& layers) {
+  if (images.empty()) {
+    throw std::invalid_argument("Texture array needs at least one image");
+  }
+  pixel_data const& first = *images.front();
+  std::size_t width = 0;
+  std::size_t height = 0;
+  std::size_t source_levels = 0;
+  for (auto const image : images) {
+    if (image->channels != first.channels || image->channel_type != first.channel_type
+     || image->compression != first.compression || image->depth > 1) {
+      throw std::invalid_argument("Texture array images need the same format and a single layer");
+    }
+    width = std::max(width, image->width);
+    height = std::max(height, image->height);
+    source_levels = std::max(source_levels, image->level_num());
+  }
+
+  // bytes of a texel or block, all images share the format
+  pixel_data::mip_level base = first.levels.empty() ? pixel_data::mip_level{0, first.pixels.size(), first.width, first.height} : first.levels.front();
+  std::size_t grid_width = 0;
+  std::size_t grid_height = 0;
+  unit_grid(first, base.width, base.height, grid_width, grid_height);
+  std::size_t unit_bytes = base.bytes / (grid_width * grid_height);
+
+  // full chain of the layer size if the images have mipmaps
+  std::vector<pixel_data::mip_level> levels{};
+  std::size_t level_width = width;
+  std::size_t level_height = height;
+  std::size_t total = 0;
+  while (true) {
+    unit_grid(first, level_width, level_height, grid_width, grid_height);
+    std::size_t bytes = grid_width * grid_height * unit_bytes * images.size();
+    levels.push_back(pixel_data::mip_level{total, bytes, level_width, level_height});
+    total += bytes;
+    if (source_levels < 2 || (level_width == 1 && level_height == 1)) {
+      break;
+    }
+    level_width = std::max(std::size_t(1), level_width / 2);
+    level_height = std::max(std::size_t(1), level_height / 2);
+  }
+
+  std::vector<std::uint8_t> texels(total);
+  for (std::size_t l = 0; l < levels.size(); ++l) {
+    unit_grid(first, levels[l].width, levels[l].height, grid_width, grid_height);
+    std::size_t layer_bytes = grid_width * grid_height * unit_bytes;
+
+    for (std::size_t i = 0; i < images.size(); ++i) {
+      pixel_data const& image = *images[i];
+      // images with a shorter chain repeat their last level
+      std::size_t source_level = std::min(l, image.level_num() - 1);
+      pixel_data::mip_level source = image.levels.empty() ? pixel_data::mip_level{0, image.pixels.size(), image.width, image.height} : image.levels[source_level];
+      std::size_t source_width = 0;
+      std::size_t source_height = 0;
+      unit_grid(image, source.width, source.height, source_width, source_height);
+      std::uint8_t const* source_texels = static_cast<std::uint8_t const*>(image.ptr(source_level));
+      std::uint8_t* target = texels.data() + levels[l].offset + i * layer_bytes;
+
+      std::size_t copy_width = std::min(grid_width, source_width);
+      for (std::size_t y = 0; y < grid_height; ++y) {
+        std::uint8_t const* source_row = source_texels + std::min(y, source_height - 1) * source_width * unit_bytes;
+        std::uint8_t* row = target + y * grid_width * unit_bytes;
+        std::memcpy(row, source_row, copy_width * unit_bytes);
+        // pad with the last unit of the row
+        for (std::size_t x = copy_width; x < grid_width; ++x) {
+          std::memcpy(row + x * unit_bytes, source_row + (copy_width - 1) * unit_bytes, unit_bytes);
+        }
+      }
+    }
+  }
+
+  layers.clear();
+  for (std::size_t i = 0; i < images.size(); ++i) {
+    layers.push_back(layer{i, glm::fvec2{float(images[i]->width) / float(width), float(images[i]->height) / float(height)}});
+  }
+
+  pixel_data result{std::move(texels), first.channels, first.channel_type, width, height, images.size()};
+  result.compression = first.compression;
+  result.levels.swap(levels);
+  return result;
+}
+
+};
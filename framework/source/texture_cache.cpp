@@ -0,0 +1,193 @@
+#include "texture_cache.hpp"
+#include "mapped_file.hpp"
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace texture_cache {
+
+// increase when the layout of the file changes
+static std::uint32_t const VERSION = 2;
+static char const MAGIC[4] = {'T', 'E', 'X', 'C'};
+// alignment of mip levels in the file
+static std::uint64_t const ALIGNMENT = 16;
+
+// fixed size file header, followed by source path, level entries and texel data
+struct header {
+  char magic[4];
+  std::uint32_t version;
+  // identify source file state
+  std::int64_t source_mtime;
+  std::uint64_t source_size;
+  std::uint32_t path_length;
+  // gl enums of the texel format
+  std::uint32_t channels;
+  std::uint32_t channel_type;
+  std::uint32_t compression;
+  std::uint32_t level_num;
+  std::uint64_t width;
+  std::uint64_t height;
+  std::uint64_t depth;
+};
+
+// per mip level entry, offset from the file start
+struct level_entry {
+  std::uint64_t offset;
+  std::uint64_t bytes;
+  std::uint64_t width;
+  std::uint64_t height;
+};
+
+static bool source_state(std::string const& source_path, std::int64_t& mtime, std::uint64_t& size) {
+  struct stat file_stat;
+  if (stat(source_path.c_str(), &file_stat) != 0) {
+    return false;
+  }
+  mtime = std::int64_t(file_stat.st_mtime);
+  size = std::uint64_t(file_stat.st_size);
+  return true;
+}
+
+static std::uint64_t align(std::uint64_t offset) {
+  return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+std::string file_path(std::string const& source_path, std::string const& variant) {
+  return source_path + "." + variant + ".texcache";
+}
+
+bool load(std::string const& source_path, std::string const& variant, pixel_data& result) {
+  std::int64_t mtime = 0;
+  std::uint64_t size = 0;
+  if (!source_state(source_path, mtime, size)) {
+    return false;
+  }
+
+  std::shared_ptr<mapped_file> file;
+  try {
+    file = std::make_shared<mapped_file>(file_path(source_path, variant));
+  }
+  catch (std::exception&) {
+    // no cache yet
+    return false;
+  }
+
+  if (file->size() < sizeof(header)) {
+    return false;
+  }
+  header head;
+  std::memcpy(&head, file->data(), sizeof(header));
+  std::uint64_t entries_offset = sizeof(header) + head.path_length;
+  // reject foreign, outdated or truncated caches
+  if (std::memcmp(head.magic, MAGIC, sizeof(MAGIC)) != 0
+   || head.version != VERSION
+   || head.source_mtime != mtime
+   || head.source_size != size
+   || head.level_num == 0
+   || entries_offset + head.level_num * sizeof(level_entry) > file->size()) {
+    return false;
+  }
+  // different files may map to the same cache name
+  std::string cached_path(reinterpret_cast<char const*>(file->data() + sizeof(header)), head.path_length);
+  if (cached_path != source_path) {
+    return false;
+  }
+
+  pixel_data cached{};
+  for (std::uint32_t i = 0; i < head.level_num; ++i) {
+    level_entry entry;
+    std::memcpy(&entry, file->data() + entries_offset + i * sizeof(level_entry), sizeof(level_entry));
+    if (entry.offset + entry.bytes > file->size()) {
+      return false;
+    }
+    cached.levels.push_back(pixel_data::mip_level{std::size_t(entry.offset), std::size_t(entry.bytes),
+                                                  std::size_t(entry.width), std::size_t(entry.height)});
+  }
+  cached.width = std::size_t(head.width);
+  cached.height = std::size_t(head.height);
+  cached.depth = std::size_t(head.depth);
+  cached.channels = GLenum(head.channels);
+  cached.channel_type = GLenum(head.channel_type);
+  cached.compression = GLenum(head.compression);
+  // texels point into the mapping and keep it alive
+  cached.storage = std::shared_ptr<std::uint8_t const>(file, file->data());
+
+  result = std::move(cached);
+  return true;
+}
+
+bool store(std::string const& source_path, std::string const& variant, pixel_data const& source) {
+  header head;
+  std::memset(&head, 0, sizeof(header));
+  if (!source_state(source_path, head.source_mtime, head.source_size)) {
+    return false;
+  }
+
+  std::memcpy(head.magic, MAGIC, sizeof(MAGIC));
+  head.version = VERSION;
+  head.path_length = std::uint32_t(source_path.size());
+  head.channels = std::uint32_t(source.channels);
+  head.channel_type = std::uint32_t(source.channel_type);
+  head.compression = std::uint32_t(source.compression);
+  head.level_num = std::uint32_t(source.level_num());
+  head.width = source.width;
+  head.height = source.height;
+  head.depth = source.depth;
+
+  // texture without explicit levels only has the base level
+  std::vector<pixel_data::mip_level> levels = source.levels;
+  if (levels.empty()) {
+    levels.push_back(pixel_data::mip_level{0, source.pixels.size(), source.width, source.height});
+  }
+  std::vector<level_entry> entries{};
+  std::uint64_t offset = sizeof(header) + head.path_length + levels.size() * sizeof(level_entry);
+  for (auto const& level : levels) {
+    offset = align(offset);
+    entries.push_back(level_entry{offset, level.bytes, level.width, level.height});
+    offset += level.bytes;
+  }
+
+  // write to temporary file and rename, so no partial cache is ever mapped
+  std::string cache_path{file_path(source_path, variant)};
+  std::string temp_path{cache_path + ".tmp"};
+  {
+    std::ofstream ofile(temp_path, std::ios::binary | std::ios::trunc);
+    if (!ofile) {
+      std::cerr << "Cache file \'" << cache_path << "\' not writable" << std::endl;
+      return false;
+    }
+    char const padding[ALIGNMENT] = {0};
+    ofile.write(reinterpret_cast<char const*>(&head), sizeof(header));
+    ofile.write(source_path.data(), std::streamsize(source_path.size()));
+    ofile.write(reinterpret_cast<char const*>(entries.data()), std::streamsize(entries.size() * sizeof(level_entry)));
+    std::uint64_t written = sizeof(header) + head.path_length + entries.size() * sizeof(level_entry);
+    for (std::size_t i = 0; i < levels.size(); ++i) {
+      ofile.write(padding, std::streamsize(entries[i].offset - written));
+      ofile.write(static_cast<char const*>(source.ptr(i)), std::streamsize(levels[i].bytes));
+      written = entries[i].offset + entries[i].bytes;
+    }
+    if (!ofile) {
+      std::cerr << "Cache file \'" << cache_path << "\' could not be written" << std::endl;
+      ofile.close();
+      std::remove(temp_path.c_str());
+      return false;
+    }
+  }
+  // rename does not replace existing files on windows
+  std::remove(cache_path.c_str());
+  if (std::rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+};
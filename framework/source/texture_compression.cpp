@@ -0,0 +1,471 @@
+#include "texture_compression.hpp"
+#include "thread_pool.hpp"
+
+#include <glbinding/gl/enum.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace texture_compression {
+
+// minimum number of blocks per parallel chunk
+static std::size_t const MIN_CHUNK = 256;
+
+// 16 rgba texels of a block in row order
+typedef std::uint8_t block_texels[16][4];
+
+GLenum internal_format(format target) {
+  switch (target) {
+    case NONE: return GL_NONE;
+    case BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BC5: return GL_COMPRESSED_RG_RGTC2;
+    case BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default: throw std::invalid_argument("Unknown compression format");
+  }
+}
+
+std::size_t block_bytes(format target) {
+  switch (target) {
+    case BC1: return 8;
+    case BC3:
+    case BC5:
+    case BC7: return 16;
+    default: throw std::invalid_argument("Compression format has no blocks");
+  }
+}
+
+std::string name(format target) {
+  switch (target) {
+    case NONE: return "none";
+    case BC1: return "bc1";
+    case BC3: return "bc3";
+    case BC5: return "bc5";
+    case BC7: return "bc7";
+    default: throw std::invalid_argument("Unknown compression format");
+  }
+}
+
+// gather block at x, y in blocks, coordinates outside the level repeat the border texels
+static void fetch_block(std::uint8_t const* texels, std::size_t width, std::size_t height, std::size_t components,
+                        std::size_t block_x, std::size_t block_y, block_texels& block) {
+  for (std::size_t i = 0; i < 16; ++i) {
+    std::size_t x = std::min(block_x * 4 + i % 4, width - 1);
+    std::size_t y = std::min(block_y * 4 + i / 4, height - 1);
+    std::uint8_t const* texel = texels + (y * width + x) * components;
+    block[i][0] = texel[0];
+    block[i][1] = components > 1 ? texel[1] : 0;
+    block[i][2] = components > 2 ? texel[2] : 0;
+    block[i][3] = components > 3 ? texel[3] : 255;
+  }
+}
+
+// direction of largest variance of the first channel_num channels, by power iteration on the covariance
+static void principal_axis(block_texels const& block, std::size_t channel_num, float (&mean)[4], float (&axis)[4]) {
+  for (std::size_t c = 0; c < 4; ++c) {
+    mean[c] = 0.0f;
+    for (std::size_t i = 0; i < 16; ++i) {
+      mean[c] += float(block[i][c]);
+    }
+    mean[c] /= 16.0f;
+  }
+  float covariance[4][4] = {};
+  for (std::size_t i = 0; i < 16; ++i) {
+    for (std::size_t a = 0; a < channel_num; ++a) {
+      for (std::size_t b = 0; b < channel_num; ++b) {
+        covariance[a][b] += (float(block[i][a]) - mean[a]) * (float(block[i][b]) - mean[b]);
+      }
+    }
+  }
+  for (std::size_t c = 0; c < 4; ++c) {
+    axis[c] = c < channel_num ? 1.0f : 0.0f;
+  }
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    float next[4] = {};
+    float length = 0.0f;
+    for (std::size_t a = 0; a < channel_num; ++a) {
+      for (std::size_t b = 0; b < channel_num; ++b) {
+        next[a] += covariance[a][b] * axis[b];
+      }
+      length = std::max(length, std::abs(next[a]));
+    }
+    // uniform block or axis orthogonal to the variance
+    if (length <= 0.0f) {
+      break;
+    }
+    for (std::size_t a = 0; a < channel_num; ++a) {
+      axis[a] = next[a] / length;
+    }
+  }
+}
+
+// end points of the block along the principal axis
+static void fit_end_points(block_texels const& block, std::size_t channel_num, float (&start)[4], float (&end)[4]) {
+  float mean[4];
+  float axis[4];
+  principal_axis(block, channel_num, mean, axis);
+  float min_t = std::numeric_limits<float>::max();
+  float max_t = -std::numeric_limits<float>::max();
+  float axis_length = 0.0f;
+  for (std::size_t c = 0; c < channel_num; ++c) {
+    axis_length += axis[c] * axis[c];
+  }
+  for (std::size_t i = 0; i < 16; ++i) {
+    float t = 0.0f;
+    for (std::size_t c = 0; c < channel_num; ++c) {
+      t += (float(block[i][c]) - mean[c]) * axis[c];
+    }
+    min_t = std::min(min_t, t);
+    max_t = std::max(max_t, t);
+  }
+  if (axis_length <= 0.0f) {
+    min_t = max_t = 0.0f;
+    axis_length = 1.0f;
+  }
+  for (std::size_t c = 0; c < 4; ++c) {
+    start[c] = std::max(0.0f, std::min(255.0f, mean[c] + axis[c] * min_t / axis_length));
+    end[c] = std::max(0.0f, std::min(255.0f, mean[c] + axis[c] * max_t / axis_length));
+  }
+}
+
+static void write16(std::uint8_t* out, std::uint32_t value) {
+  out[0] = std::uint8_t(value & 0xFF);
+  out[1] = std::uint8_t(value >> 8);
+}
+
+static void write32(std::uint8_t* out, std::uint32_t value) {
+  write16(out, value & 0xFFFF);
+  write16(out + 2, value >> 16);
+}
+
+// rgb565 color from floats
+static std::uint32_t pack565(float const (&color)[4]) {
+  std::uint32_t r = std::uint32_t(color[0] * 31.0f / 255.0f + 0.5f);
+  std::uint32_t g = std::uint32_t(color[1] * 63.0f / 255.0f + 0.5f);
+  std::uint32_t b = std::uint32_t(color[2] * 31.0f / 255.0f + 0.5f);
+  return (r << 11) | (g << 5) | b;
+}
+
+static void unpack565(std::uint32_t color, int (&rgb)[3]) {
+  int r = int(color >> 11) & 31;
+  int g = int(color >> 5) & 63;
+  int b = int(color) & 31;
+  rgb[0] = (r << 3) | (r >> 2);
+  rgb[1] = (g << 2) | (g >> 4);
+  rgb[2] = (b << 3) | (b >> 2);
+}
+
+// indices of the nearest colors of the 4 color palette, returns the squared error
+static int bc1_indices(block_texels const& block, std::uint32_t color0, std::uint32_t color1, std::uint32_t& indices) {
+  int palette[4][3];
+  unpack565(color0, palette[0]);
+  unpack565(color1, palette[1]);
+  for (std::size_t c = 0; c < 3; ++c) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+  indices = 0;
+  int error = 0;
+  for (std::size_t i = 0; i < 16; ++i) {
+    int best = std::numeric_limits<int>::max();
+    std::uint32_t best_index = 0;
+    for (std::uint32_t p = 0; p < 4; ++p) {
+      int distance = 0;
+      for (std::size_t c = 0; c < 3; ++c) {
+        int difference = int(block[i][c]) - palette[p][c];
+        distance += difference * difference;
+      }
+      if (distance < best) {
+        best = distance;
+        best_index = p;
+      }
+    }
+    indices |= best_index << (i * 2);
+    error += best;
+  }
+  return error;
+}
+
+// end points minimizing the squared error for fixed indices
+static bool bc1_least_squares(block_texels const& block, std::uint32_t indices, float (&color0)[4], float (&color1)[4]) {
+  // weights of color0 per palette index
+  static float const weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+  float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+  float ax[3] = {}, bx[3] = {};
+  for (std::size_t i = 0; i < 16; ++i) {
+    float a = weights[(indices >> (i * 2)) & 3];
+    float b = 1.0f - a;
+    aa += a * a;
+    bb += b * b;
+    ab += a * b;
+    for (std::size_t c = 0; c < 3; ++c) {
+      ax[c] += a * float(block[i][c]);
+      bx[c] += b * float(block[i][c]);
+    }
+  }
+  float determinant = aa * bb - ab * ab;
+  if (std::abs(determinant) < 1e-6f) {
+    return false;
+  }
+  for (std::size_t c = 0; c < 3; ++c) {
+    color0[c] = std::max(0.0f, std::min(255.0f, (ax[c] * bb - bx[c] * ab) / determinant));
+    color1[c] = std::max(0.0f, std::min(255.0f, (bx[c] * aa - ax[c] * ab) / determinant));
+  }
+  return true;
+}
+
+// 4 color mode only, the 3 color mode with transparency is never used
+static void encode_bc1(block_texels const& block, std::uint8_t* out) {
+  float start[4];
+  float end[4];
+  fit_end_points(block, 3, start, end);
+  std::uint32_t color0 = pack565(end);
+  std::uint32_t color1 = pack565(start);
+  std::uint32_t indices = 0;
+  int error = bc1_indices(block, color0, color1, indices);
+  // refine end points once for the chosen indices
+  if (error > 0 && bc1_least_squares(block, indices, end, start)) {
+    std::uint32_t refined0 = pack565(end);
+    std::uint32_t refined1 = pack565(start);
+    std::uint32_t refined_indices = 0;
+    if (bc1_indices(block, refined0, refined1, refined_indices) < error) {
+      color0 = refined0;
+      color1 = refined1;
+      indices = refined_indices;
+    }
+  }
+
+  // color0 > color1 selects 4 color mode, swapping colors swaps indices 0 and 1, 2 and 3
+  if (color0 < color1) {
+    std::swap(color0, color1);
+    indices ^= 0x55555555;
+  }
+  else if (color0 == color1) {
+    indices = 0;
+  }
+  write16(out, color0);
+  write16(out + 2, color1);
+  write32(out + 4, indices);
+}
+
+// single channel block with the 8 value palette
+static void encode_bc4(block_texels const& block, std::size_t channel, std::uint8_t* out) {
+  int min_value = 255;
+  int max_value = 0;
+  for (std::size_t i = 0; i < 16; ++i) {
+    min_value = std::min(min_value, int(block[i][channel]));
+    max_value = std::max(max_value, int(block[i][channel]));
+  }
+  out[0] = std::uint8_t(max_value);
+  out[1] = std::uint8_t(min_value);
+  std::uint64_t indices = 0;
+  if (max_value > min_value) {
+    // palette index of the 8 steps from max to min
+    static std::uint64_t const step_index[8] = {0, 2, 3, 4, 5, 6, 7, 1};
+    int range = max_value - min_value;
+    for (std::size_t i = 0; i < 16; ++i) {
+      int step = ((max_value - int(block[i][channel])) * 14 + range) / (range * 2);
+      indices |= step_index[step] << (i * 3);
+    }
+  }
+  for (std::size_t i = 0; i < 6; ++i) {
+    out[2 + i] = std::uint8_t((indices >> (i * 8)) & 0xFF);
+  }
+}
+
+static void encode_bc3(block_texels const& block, std::uint8_t* out) {
+  encode_bc4(block, 3, out);
+  encode_bc1(block, out + 8);
+}
+
+static void encode_bc5(block_texels const& block, std::uint8_t* out) {
+  encode_bc4(block, 0, out);
+  encode_bc4(block, 1, out + 8);
+}
+
+// appends bits from least significant to most significant
+struct bit_writer {
+  explicit bit_writer(std::uint8_t* out)
+   :data{out}
+   ,position{0}
+  {
+    std::memset(data, 0, 16);
+  }
+
+  void write(std::uint32_t value, std::size_t bit_num) {
+    for (std::size_t i = 0; i < bit_num; ++i, ++position) {
+      data[position / 8] = std::uint8_t(data[position / 8] | (((value >> i) & 1) << (position % 8)));
+    }
+  }
+
+  std::uint8_t* data;
+  std::size_t position;
+};
+
+// interpolation weights of 4 bit indices in 1/64
+static int const BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// nearest palette indices of the end points, returns the squared error
+static int bc7_indices(block_texels const& block, int const (&start)[4], int const (&end)[4], std::uint32_t (&indices)[16]) {
+  int palette[16][4];
+  for (std::size_t w = 0; w < 16; ++w) {
+    for (std::size_t c = 0; c < 4; ++c) {
+      palette[w][c] = ((64 - BC7_WEIGHTS[w]) * start[c] + BC7_WEIGHTS[w] * end[c] + 32) >> 6;
+    }
+  }
+  float direction[4];
+  float length = 0.0f;
+  for (std::size_t c = 0; c < 4; ++c) {
+    direction[c] = float(end[c] - start[c]);
+    length += direction[c] * direction[c];
+  }
+  int error = 0;
+  for (std::size_t i = 0; i < 16; ++i) {
+    // project on the segment and search the neighbourhood of the projection
+    float t = 0.0f;
+    for (std::size_t c = 0; c < 4; ++c) {
+      t += (float(block[i][c]) - float(start[c])) * direction[c];
+    }
+    int guess = length > 0.0f ? int(std::max(0.0f, std::min(15.0f, t / length * 15.0f + 0.5f))) : 0;
+    int best = std::numeric_limits<int>::max();
+    for (int w = std::max(0, guess - 1); w <= std::min(15, guess + 1); ++w) {
+      int distance = 0;
+      for (std::size_t c = 0; c < 4; ++c) {
+        int difference = int(block[i][c]) - palette[w][c];
+        distance += difference * difference;
+      }
+      if (distance < best) {
+        best = distance;
+        indices[i] = std::uint32_t(w);
+      }
+    }
+    error += best;
+  }
+  return error;
+}
+
+// mode 6, one subset with 7 bit rgba end points, a shared bit each and 4 bit indices
+static void encode_bc7(block_texels const& block, std::uint8_t* out) {
+  float start[4];
+  float end[4];
+  fit_end_points(block, 4, start, end);
+
+  int best_error = std::numeric_limits<int>::max();
+  int best_start[4] = {};
+  int best_end[4] = {};
+  std::uint32_t best_indices[16] = {};
+  // try all combinations of the shared least significant bits
+  for (int bits = 0; bits < 4; ++bits) {
+    int start_bit = bits & 1;
+    int end_bit = bits >> 1;
+    int quantized_start[4];
+    int quantized_end[4];
+    for (std::size_t c = 0; c < 4; ++c) {
+      int s = std::max(0, std::min(127, int((start[c] - float(start_bit)) / 2.0f + 0.5f)));
+      int e = std::max(0, std::min(127, int((end[c] - float(end_bit)) / 2.0f + 0.5f)));
+      quantized_start[c] = (s << 1) | start_bit;
+      quantized_end[c] = (e << 1) | end_bit;
+    }
+    std::uint32_t indices[16];
+    int error = bc7_indices(block, quantized_start, quantized_end, indices);
+    if (error < best_error) {
+      best_error = error;
+      std::copy(quantized_start, quantized_start + 4, best_start);
+      std::copy(quantized_end, quantized_end + 4, best_end);
+      std::copy(indices, indices + 16, best_indices);
+    }
+  }
+
+  // the most significant bit of the first index is implicitly 0
+  if (best_indices[0] >= 8) {
+    std::swap(best_start, best_end);
+    for (auto& index : best_indices) {
+      index = 15 - index;
+    }
+  }
+
+  bit_writer writer{out};
+  writer.write(1 << 6, 7);
+  for (std::size_t c = 0; c < 4; ++c) {
+    writer.write(std::uint32_t(best_start[c] >> 1), 7);
+    writer.write(std::uint32_t(best_end[c] >> 1), 7);
+  }
+  writer.write(std::uint32_t(best_start[0] & 1), 1);
+  writer.write(std::uint32_t(best_end[0] & 1), 1);
+  writer.write(best_indices[0], 3);
+  for (std::size_t i = 1; i < 16; ++i) {
+    writer.write(best_indices[i], 4);
+  }
+}
+
+void compress(pixel_data& image, format target) {
+  if (target == NONE) {
+    return;
+  }
+  if (image.compression != GL_NONE || image.channel_type != GL_UNSIGNED_BYTE) {
+    throw std::logic_error("Compression needs an uncompressed texture with unsigned byte channels");
+  }
+  std::size_t components = 0;
+  switch (image.channels) {
+    case GL_RED: components = 1; break;
+    case GL_RG: components = 2; break;
+    case GL_RGB: components = 3; break;
+    case GL_RGBA: components = 4; break;
+    default: throw std::logic_error("Unsupported channel format for compression");
+  }
+  void (*encode)(block_texels const&, std::uint8_t*) = nullptr;
+  switch (target) {
+    case BC1: encode = encode_bc1; break;
+    case BC3: encode = encode_bc3; break;
+    case BC5: encode = encode_bc5; break;
+    case BC7: encode = encode_bc7; break;
+    default: throw std::invalid_argument("Unknown compression format");
+  }
+  std::size_t bytes = block_bytes(target);
+
+  // image without explicit levels only has the base level
+  std::vector<pixel_data::mip_level> levels = image.levels;
+  if (levels.empty()) {
+    levels.push_back(pixel_data::mip_level{0, image.pixels.size(), image.width, image.height});
+  }
+  std::vector<pixel_data::mip_level> compressed_levels{};
+  std::size_t total = 0;
+  // layers are consecutive in a level and compressed separately
+  std::size_t layers = std::max(std::size_t(1), image.depth);
+  for (auto const& level : levels) {
+    std::size_t block_num = ((level.width + 3) / 4) * ((level.height + 3) / 4) * layers;
+    compressed_levels.push_back(pixel_data::mip_level{total, block_num * bytes, level.width, level.height});
+    total += block_num * bytes;
+  }
+
+  std::vector<std::uint8_t> blocks(total);
+  for (std::size_t l = 0; l < levels.size(); ++l) {
+    std::uint8_t const* texels = static_cast<std::uint8_t const*>(image.ptr(l));
+    std::uint8_t* out = blocks.data() + compressed_levels[l].offset;
+    std::size_t blocks_x = (levels[l].width + 3) / 4;
+    std::size_t block_num = compressed_levels[l].bytes / bytes;
+    std::size_t layer_blocks = block_num / layers;
+    std::size_t layer_bytes = levels[l].width * levels[l].height * components;
+    parallel_for(block_num, [&](std::size_t, std::size_t begin, std::size_t end) {
+      block_texels block;
+      for (std::size_t b = begin; b < end; ++b) {
+        std::size_t layer_block = b % layer_blocks;
+        fetch_block(texels + b / layer_blocks * layer_bytes, levels[l].width, levels[l].height, components,
+                    layer_block % blocks_x, layer_block / blocks_x, block);
+        encode(block, out + b * bytes);
+      }
+    }, MIN_CHUNK);
+  }
+
+  image.pixels.swap(blocks);
+  image.storage.reset();
+  image.levels.swap(compressed_levels);
+  image.compression = internal_format(target);
+}
+
+};
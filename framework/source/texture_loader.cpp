@@ -1,4 +1,7 @@
 #include "texture_loader.hpp"
+#include "texture_cache.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
 
 // request supported types
 #define STBI_ONLY_JPEG
@@ -11,24 +14,36 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
  
+#include <algorithm>
+#include <cmath>
 #include <cstdint> 
 #include <cstring> 
+#include <future>
+#include <mutex>
 #include <stdexcept> 
 
 namespace texture_loader {
-pixel_data file(std::string const& file_name) {
+
+// flip flag is a global of stb_image, so it is only written once before any decode
+static std::once_flag flip_flag;
+
+pixel_data decode(std::string const& file_name) {
   // match to opengl representation
-  stbi_set_flip_vertically_on_load(true);
+  std::call_once(flip_flag, [](){ stbi_set_flip_vertically_on_load(true); });
 
-  uint8_t* data_ptr;
   int width = 0;
   int height = 0;
   int format = STBI_default;
-  data_ptr = stbi_load(file_name.c_str(), &width, &height, &format, STBI_rgb_alpha);
+  // keep the channels of the file, so format matches the decoded data
+  uint8_t* data_ptr = stbi_load(file_name.c_str(), &width, &height, &format, STBI_default);
 
   if(!data_ptr) {
     throw std::logic_error(std::string{"stb_image: "} + stbi_failure_reason());
   }
+  // decoded memory is owned by the result instead of copied, and freed by stb_image
+  std::shared_ptr<std::uint8_t const> texels{data_ptr, [](std::uint8_t const* ptr) {
+    stbi_image_free(const_cast<std::uint8_t*>(ptr));
+  }};
 
   // determine format of image data, internal format should be sized
   GLenum pixel_format = GL_NONE;
@@ -53,12 +68,347 @@ pixel_data file(std::string const& file_name) {
     throw std::logic_error("stb_image: misinterpreted data, incorrect format");
   }
 
-  std::vector<uint8_t> texture_data(width * height * num_components);
-  // copy data to vector
-  std::memcpy(&texture_data[0], data_ptr, texture_data.size());
-  stbi_image_free(data_ptr);
+  std::size_t bytes = std::size_t(width) * std::size_t(height) * num_components;
+  return pixel_data{std::move(texels), bytes, pixel_format, GL_UNSIGNED_BYTE, std::size_t(width), std::size_t(height)};
+}
+
+static std::size_t component_num(GLenum channels) {
+  switch (channels) {
+    case GL_RED: return 1;
+    case GL_RG: return 2;
+    case GL_RGB: return 3;
+    case GL_RGBA: return 4;
+    default: throw std::logic_error("Unsupported channel format for mipmaps");
+  }
+}
+
+pixel_data file(std::string const& file_name, options const& settings) {
+  pixel_data result{};
+  // mip chain and blocks depend on the settings
+  std::string variant = settings.srgb ? "srgb" : "linear";
+  if (settings.cube_map) {
+    variant += ".cube";
+  }
+  if (settings.compression != texture_compression::NONE) {
+    variant += "." + texture_compression::name(settings.compression);
+  }
+  // reuse decoded texture from previous run
+  if (texture_cache::load(file_name, variant, result)) {
+    return result;
+  }
+  result = decode(file_name);
+  if (settings.cube_map) {
+    result = cube_faces(result, settings.srgb);
+  }
+  else {
+    generate_mipmaps(result, settings.srgb);
+  }
+  texture_compression::compress(result, settings.compression);
+  // failing to write the cache only costs time on the next run
+  texture_cache::store(file_name, variant, result);
+  return result;
+}
+
+// conversion between 8 bit srgb and linear values
+struct gamma_tables {
+  gamma_tables()
+   :to_linear(256)
+   ,to_srgb(LINEAR_STEPS + 1)
+  {
+    for (std::size_t i = 0; i < to_linear.size(); ++i) {
+      float c = float(i) / 255.0f;
+      to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (std::size_t i = 0; i < to_srgb.size(); ++i) {
+      float l = float(i) / float(LINEAR_STEPS);
+      float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+      to_srgb[i] = std::uint8_t(c * 255.0f + 0.5f);
+    }
+  }
+
+  // resolution of linear values, fine enough for the steep srgb curve near black
+  static std::size_t const LINEAR_STEPS = 65535;
+  std::vector<float> to_linear;
+  std::vector<std::uint8_t> to_srgb;
+};
+
+static gamma_tables const& gamma() {
+  static gamma_tables const tables{};
+  return tables;
+}
+
+// which channels are srgb encoded and their tables to linear values, alpha is never encoded
+static void channel_decoding(GLenum channels, bool srgb, bool encoded[4], float const* decode_tables[4]) {
+  // linear channels use the same lookup path with a plain scale
+  static std::vector<float> const to_unorm = [](){
+    std::vector<float> table(256);
+    for (std::size_t i = 0; i < table.size(); ++i) {
+      table[i] = float(i) / 255.0f;
+    }
+    return table;
+  }();
+  std::size_t components = component_num(channels);
+  bool alpha = channels == GL_RG || channels == GL_RGBA;
+  for (std::size_t c = 0; c < 4; ++c) {
+    encoded[c] = srgb && !(alpha && c == components - 1);
+    decode_tables[c] = encoded[c] ? gamma().to_linear.data() : to_unorm.data();
+  }
+}
+
+// 8 bit channel from a linear value
+static std::uint8_t encode_channel(float value, bool encoded) {
+  value = std::max(0.0f, std::min(1.0f, value));
+  return encoded ? gamma().to_srgb[std::size_t(value * float(gamma_tables::LINEAR_STEPS) + 0.5f)]
+                 : std::uint8_t(value * 255.0f + 0.5f);
+}
+
+// minimum number of target texels per parallel chunk
+static std::size_t const MIN_CHUNK = 1 << 14;
+
+// 2x2 box filter of linear texels, odd sizes are clamped at the border
+static void downsample(float const* source, pixel_data::mip_level const& source_level,
+                       float* target, pixel_data::mip_level const& target_level, std::size_t components) {
+  std::size_t source_width = source_level.width;
+  std::size_t width = target_level.width;
+  // texels whose 2x2 footprint lies completely inside the source row
+  std::size_t inner = std::min(width, source_width / 2);
+  simd::float4 const quarter = simd::set4(0.25f);
+
+  parallel_for(target_level.height, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t y = begin; y < end; ++y) {
+      float const* row0 = source + std::min(y * 2, source_level.height - 1) * source_width * components;
+      float const* row1 = source + std::min(y * 2 + 1, source_level.height - 1) * source_width * components;
+      float* out = target + y * width * components;
+      std::size_t x = 0;
+      if (components == 4) {
+        // one rgba texel per vector
+        for (; x < inner; ++x) {
+          simd::float4 sum = simd::add4(simd::add4(simd::load4(row0 + x * 8), simd::load4(row0 + x * 8 + 4)),
+                                        simd::add4(simd::load4(row1 + x * 8), simd::load4(row1 + x * 8 + 4)));
+          simd::store4(out + x * 4, simd::mul4(sum, quarter));
+        }
+      }
+      else if (components == 3) {
+        // one rgb texel per vector from overlapping loads. the fourth lane spills into the next texel,
+        // which is written afterwards, so the last texel of the row is left to the scalar loop
+        for (; x + 1 < inner; ++x) {
+          simd::float4 sum = simd::add4(simd::add4(simd::load4(row0 + x * 6), simd::load4(row0 + x * 6 + 3)),
+                                        simd::add4(simd::load4(row1 + x * 6), simd::load4(row1 + x * 6 + 3)));
+          simd::store4(out + x * 3, simd::mul4(sum, quarter));
+        }
+      }
+      else if (components == 2) {
+        // two rg target texels per vector
+        for (; x + 1 < inner; x += 2) {
+          simd::float4 sum = simd::add4(simd::pair_sum4(simd::load4(row0 + x * 4), simd::load4(row0 + x * 4 + 4)),
+                                        simd::pair_sum4(simd::load4(row1 + x * 4), simd::load4(row1 + x * 4 + 4)));
+          simd::store4(out + x * 2, simd::mul4(sum, quarter));
+        }
+      }
+      for (; x < width; ++x) {
+        std::size_t x0 = std::min(x * 2, source_width - 1) * components;
+        std::size_t x1 = std::min(x * 2 + 1, source_width - 1) * components;
+        for (std::size_t c = 0; c < components; ++c) {
+          out[x * components + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+        }
+      }
+    }
+  }, MIN_CHUNK / width + 1);
+}
+
+void generate_mipmaps(pixel_data& image, bool srgb) {
+  if (image.compression != GL_NONE || image.channel_type != GL_UNSIGNED_BYTE || image.depth > 1) {
+    throw std::logic_error("Mipmaps need an uncompressed 2d texture with unsigned byte channels");
+  }
+  std::size_t components = component_num(image.channels);
+  // drop previous chain
+  std::vector<pixel_data::mip_level> levels{pixel_data::mip_level{0, image.width * image.height * components, image.width, image.height}};
+  std::size_t total = levels.front().bytes;
+  while (levels.back().width > 1 || levels.back().height > 1) {
+    pixel_data::mip_level const& previous = levels.back();
+    std::size_t width = std::max(std::size_t(1), previous.width / 2);
+    std::size_t height = std::max(std::size_t(1), previous.height / 2);
+    levels.push_back(pixel_data::mip_level{total, width * height * components, width, height});
+    total += levels.back().bytes;
+  }
+  // the chain is one buffer, so a base level in external storage is copied once
+  if (image.storage) {
+    std::uint8_t const* texels = static_cast<std::uint8_t const*>(image.ptr());
+    std::vector<std::uint8_t> chain(total);
+    std::copy(texels, texels + levels.front().bytes, chain.begin());
+    image.pixels.swap(chain);
+    image.storage.reset();
+  }
+  else {
+    image.pixels.resize(total);
+  }
+
+  bool encoded[4];
+  float const* decode_tables[4];
+  channel_decoding(image.channels, srgb, encoded, decode_tables);
+
+  // filter in linear float space, so rounding errors do not accumulate over the levels
+  std::vector<float> source(levels.front().bytes);
+  std::uint8_t const* base = image.pixels.data();
+  parallel_for(image.width * image.height, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin * components; i < end * components; i += components) {
+      for (std::size_t c = 0; c < components; ++c) {
+        source[i + c] = decode_tables[c][base[i + c]];
+      }
+    }
+  }, MIN_CHUNK);
+
+  std::vector<float> target{};
+  for (std::size_t l = 1; l < levels.size(); ++l) {
+    target.resize(levels[l].bytes);
+    downsample(source.data(), levels[l - 1], target.data(), levels[l], components);
+    std::uint8_t* out = image.pixels.data() + levels[l].offset;
+    parallel_for(levels[l].width * levels[l].height, [&](std::size_t, std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin * components; i < end * components; i += components) {
+        for (std::size_t c = 0; c < components; ++c) {
+          out[i + c] = encode_channel(target[i + c], encoded[c]);
+        }
+      }
+    }, MIN_CHUNK);
+    source.swap(target);
+  }
+  image.levels.swap(levels);
+}
+
+// texels a bilinear lookup may read, columns wrap around for panoramas
+struct sample_region {
+  std::size_t x;
+  std::size_t y;
+  std::size_t width;
+  std::size_t height;
+  bool wrap;
+};
+
+// bilinear lookup at texel coordinates of the region, texel centers lie at integers
+static simd::float4 bilinear(std::uint8_t const* texels, std::size_t row_texels, std::size_t components,
+                             float const* const* decode_tables, sample_region const& region, float x, float y) {
+  float floor_x = std::floor(x);
+  float floor_y = std::floor(y);
+  float weight_x = x - floor_x;
+  float weight_y = y - floor_y;
+  long width = long(region.width);
+  long height = long(region.height);
+  long columns[2] = {long(floor_x), long(floor_x) + 1};
+  long rows[2] = {long(floor_y), long(floor_y) + 1};
+  for (std::size_t i = 0; i < 2; ++i) {
+    columns[i] = region.wrap ? (columns[i] % width + width) % width : std::max(0l, std::min(width - 1, columns[i]));
+    rows[i] = std::max(0l, std::min(height - 1, rows[i]));
+  }
+  // corners in linear space, unused channels stay zero
+  float corners[4][4] = {};
+  for (std::size_t i = 0; i < 4; ++i) {
+    std::uint8_t const* texel = texels + ((region.y + std::size_t(rows[i / 2])) * row_texels + region.x + std::size_t(columns[i % 2])) * components;
+    for (std::size_t c = 0; c < components; ++c) {
+      corners[i][c] = decode_tables[c][texel[c]];
+    }
+  }
+  simd::float4 top = simd::add4(simd::mul4(simd::load4(corners[0]), simd::set4(1.0f - weight_x)),
+                                simd::mul4(simd::load4(corners[1]), simd::set4(weight_x)));
+  simd::float4 bottom = simd::add4(simd::mul4(simd::load4(corners[2]), simd::set4(1.0f - weight_x)),
+                                   simd::mul4(simd::load4(corners[3]), simd::set4(weight_x)));
+  return simd::add4(simd::mul4(top, simd::set4(1.0f - weight_y)), simd::mul4(bottom, simd::set4(weight_y)));
+}
 
-  return pixel_data{texture_data, pixel_format, GL_UNSIGNED_BYTE, std::size_t(width), std::size_t(height)};
+// direction through a point of a cube map face at s and t in [-1, 1], as defined by the gl specification
+static void face_direction(std::size_t face, float s, float t, float direction[3]) {
+  float const directions[6][3] = {{1.0f, -t, -s}, {-1.0f, -t, s}, {s, 1.0f, t}, {s, -1.0f, -t}, {s, -t, 1.0f}, {-s, -t, -1.0f}};
+  std::copy(directions[face], directions[face] + 3, direction);
+}
+
+pixel_data cube_faces(pixel_data const& image, bool srgb, std::size_t face_size) {
+  if (image.compression != GL_NONE || image.channel_type != GL_UNSIGNED_BYTE || image.depth > 1) {
+    throw std::logic_error("Cube faces need an uncompressed 2d image with unsigned byte channels");
+  }
+  bool panorama = image.width == image.height * 2;
+  if (!panorama && image.width * 3 != image.height * 4) {
+    throw std::invalid_argument("Cube faces need an equirectangular or horizontal cross image");
+  }
+  // a face spans a quarter of the horizon in both layouts
+  std::size_t cell = image.width / 4;
+  face_size = face_size > 0 ? face_size : cell;
+  std::size_t components = component_num(image.channels);
+  bool encoded[4];
+  float const* decode_tables[4];
+  channel_decoding(image.channels, srgb, encoded, decode_tables);
+
+  // cells of the cross in rows from the bottom, images are flipped on load
+  std::size_t const cross_cells[6][2] = {{2, 1}, {0, 1}, {1, 0}, {1, 2}, {1, 1}, {3, 1}};
+  std::uint8_t const* texels = static_cast<std::uint8_t const*>(image.ptr());
+  std::size_t face_bytes = face_size * face_size * components;
+  std::vector<std::uint8_t> faces(face_bytes * 6);
+  float const pi = 3.14159265358979f;
+
+  parallel_for(6, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t face = begin; face < end; ++face) {
+      sample_region region{0, 0, image.width, image.height, true};
+      if (!panorama) {
+        region = sample_region{cross_cells[face][0] * cell, cross_cells[face][1] * cell, cell, cell, false};
+      }
+      std::uint8_t* out = faces.data() + face * face_bytes;
+      float linear[4];
+      for (std::size_t y = 0; y < face_size; ++y) {
+        for (std::size_t x = 0; x < face_size; ++x) {
+          float sample_x = 0.0f;
+          float sample_y = 0.0f;
+          if (panorama) {
+            // longitude and latitude like the texcoords of the generated spheres
+            float direction[3];
+            face_direction(face, (float(x) + 0.5f) / float(face_size) * 2.0f - 1.0f,
+                                 (float(y) + 0.5f) / float(face_size) * 2.0f - 1.0f, direction);
+            float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+            float u = std::atan2(direction[0], direction[2]) / (2.0f * pi);
+            float v = 1.0f - std::acos(direction[1] / length) / pi;
+            sample_x = (u < 0.0f ? u + 1.0f : u) * float(image.width) - 0.5f;
+            sample_y = v * float(image.height) - 0.5f;
+          }
+          else {
+            sample_x = (float(x) + 0.5f) * float(cell) / float(face_size) - 0.5f;
+            sample_y = (float(y) + 0.5f) * float(cell) / float(face_size) - 0.5f;
+          }
+          simd::store4(linear, bilinear(texels, image.width, components, decode_tables, region, sample_x, sample_y));
+          for (std::size_t c = 0; c < components; ++c) {
+            out[(y * face_size + x) * components + c] = encode_channel(linear[c], encoded[c]);
+          }
+        }
+      }
+    }
+  }, 1);
+
+  return pixel_data{std::move(faces), image.channels, image.channel_type, face_size, face_size, 6};
+}
+
+std::vector<pixel_data> files(std::vector<std::string> const& file_names, std::vector<options> const& settings) {
+  std::vector<pixel_data> results(file_names.size());
+  std::vector<options> file_settings{settings};
+  file_settings.resize(file_names.size());
+  // waiting on pool tasks from a worker could deadlock
+  if (thread_pool::in_worker()) {
+    for (std::size_t i = 0; i < file_names.size(); ++i) {
+      results[i] = file(file_names[i], file_settings[i]);
+    }
+    return results;
+  }
+
+  // one task per image, images differ in size so chunks would be unbalanced
+  std::vector<std::future<void>> decodes{};
+  for (std::size_t i = 0; i < file_names.size(); ++i) {
+    decodes.push_back(thread_pool::global().submit([&file_names, &file_settings, &results, i](){
+      results[i] = file(file_names[i], file_settings[i]);
+    }));
+  }
+  // tasks reference the arguments, so all must finish before an error is thrown
+  for (auto& decode : decodes) {
+    decode.wait();
+  }
+  for (auto& decode : decodes) {
+    decode.get();
+  }
+  return results;
 }
 
 };
\ No newline at end of file
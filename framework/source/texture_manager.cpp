@@ -0,0 +1,131 @@
+#include "texture_manager.hpp"
+#include "texture_loader.hpp"
+#include "utils.hpp"
+
+#include <glbinding/gl/functions.h>
+
+managed_texture::managed_texture(texture_manager* owner, pixel_data image)
+ :m_owner{owner}
+ ,m_image(std::move(image))
+ ,m_object{}
+ ,m_resident_level{0}
+ ,m_resident_bytes{0}
+ ,m_frame{0}
+ ,m_use{}
+{}
+
+texture_manager::texture_manager(std::size_t budget, std::size_t evicted_size)
+ :m_budget{budget}
+ ,m_evicted_size{evicted_size}
+ ,m_allocated{0}
+ ,m_frame{0}
+ ,m_textures{}
+{}
+
+texture_manager::~texture_manager() {
+  for (auto texture : m_textures) {
+    glDeleteTextures(1, &texture->m_object.handle);
+    texture->m_object = texture_object{};
+    texture->m_owner = nullptr;
+  }
+}
+
+texture_handle texture_manager::create(pixel_data image) {
+  // images without mip chain get one filtered on the cpu, compressed blocks and layers can not be filtered
+  if (image.level_num() < 2 && (image.width > 1 || image.height > 1) && image.compression == GL_NONE && image.depth < 2) {
+    texture_loader::generate_mipmaps(image);
+  }
+  texture_handle texture{new managed_texture{this, std::move(image)}, &texture_manager::release};
+  make_room(level_bytes(texture->m_image, 0));
+  upload(*texture, 0);
+  m_textures.push_front(texture.get());
+  texture->m_use = m_textures.begin();
+  texture->m_frame = m_frame;
+  return texture;
+}
+
+texture_object const& texture_manager::use(texture_handle const& texture) {
+  texture->m_frame = m_frame;
+  m_textures.splice(m_textures.begin(), m_textures, texture->m_use);
+  if (texture->m_resident_level > 0) {
+    make_room(level_bytes(texture->m_image, 0) - texture->m_resident_bytes);
+    upload(*texture, 0);
+  }
+  return texture->m_object;
+}
+
+void texture_manager::next_frame() {
+  ++m_frame;
+}
+
+void texture_manager::set_budget(std::size_t budget) {
+  m_budget = budget;
+  make_room(0);
+}
+
+void texture_manager::release(managed_texture* texture) {
+  texture_manager* owner = texture->m_owner;
+  if (owner) {
+    glDeleteTextures(1, &texture->m_object.handle);
+    owner->m_allocated -= texture->m_resident_bytes;
+    owner->m_textures.erase(texture->m_use);
+  }
+  delete texture;
+}
+
+void texture_manager::make_room(std::size_t bytes) {
+  // textures used in this frame are kept, the budget is exceeded if they do not fit
+  for (auto i = m_textures.rbegin(); i != m_textures.rend() && m_allocated + bytes > m_budget; ++i) {
+    managed_texture& texture = **i;
+    std::size_t level = evicted_level(texture);
+    if (texture.m_frame != m_frame && texture.m_resident_level < level) {
+      upload(texture, level);
+    }
+  }
+}
+
+std::size_t texture_manager::evicted_level(managed_texture const& texture) const {
+  pixel_data const& image = texture.m_image;
+  std::size_t level = 0;
+  while (level + 1 < image.level_num()
+      && (image.levels[level].width > m_evicted_size || image.levels[level].height > m_evicted_size)) {
+    ++level;
+  }
+  return level;
+}
+
+std::size_t texture_manager::level_bytes(pixel_data const& image, std::size_t level) {
+  if (image.levels.empty()) {
+    return image.pixels.size();
+  }
+  std::size_t bytes = 0;
+  for (std::size_t l = level; l < image.levels.size(); ++l) {
+    bytes += image.levels[l].bytes;
+  }
+  return bytes;
+}
+
+void texture_manager::upload(managed_texture& texture, std::size_t level) {
+  pixel_data const& image = texture.m_image;
+  // a new object releases the memory of the old levels, redefining them would keep it
+  texture_object object{};
+  // several layers make an array texture
+  object.target = image.depth > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+  glGenTextures(1, &object.handle);
+  glBindTexture(object.target, object.handle);
+  glTexParameteri(object.target, GL_TEXTURE_MIN_FILTER, image.level_num() - level > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(object.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(object.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(object.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(object.target, GL_TEXTURE_MAX_LEVEL, GLint(image.level_num() - level - 1));
+  for (std::size_t l = level; l < image.level_num(); ++l) {
+    utils::tex_image(object.target, image, l, level);
+  }
+
+  glDeleteTextures(1, &texture.m_object.handle);
+  m_allocated -= texture.m_resident_bytes;
+  texture.m_object = object;
+  texture.m_resident_level = level;
+  texture.m_resident_bytes = level_bytes(image, level);
+  m_allocated += texture.m_resident_bytes;
+}
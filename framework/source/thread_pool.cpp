@@ -0,0 +1,115 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <exception>
+
+// marks pool workers to detect nested parallelism
+static thread_local bool is_worker = false;
+
+thread_pool::thread_pool(std::size_t num_threads)
+ :m_workers{}
+ ,m_tasks{}
+ ,m_mutex{}
+ ,m_condition{}
+ ,m_stop{false}
+{
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (std::size_t i = 0; i < num_threads; ++i) {
+    m_workers.emplace_back(&thread_pool::work, this);
+  }
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+std::size_t thread_pool::size() const {
+  return m_workers.size();
+}
+
+thread_pool& thread_pool::global() {
+  static thread_pool pool{};
+  return pool;
+}
+
+bool thread_pool::in_worker() {
+  return is_worker;
+}
+
+void thread_pool::work() {
+  is_worker = true;
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_condition.wait(lock, [this](){ return m_stop || !m_tasks.empty(); });
+      // only stop once queue is drained
+      if (m_tasks.empty()) {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop();
+    }
+    task();
+  }
+}
+
+std::size_t parallel_chunks(std::size_t count, std::size_t min_chunk_size) {
+  if (count == 0) {
+    return 0;
+  }
+  min_chunk_size = std::max(std::size_t(1), min_chunk_size);
+  // calling thread processes one chunk as well
+  std::size_t max_chunks = thread_pool::global().size() + 1;
+  return std::max(std::size_t(1), std::min(max_chunks, count / min_chunk_size));
+}
+
+void parallel_for(std::size_t count, std::function<void(std::size_t, std::size_t, std::size_t)> const& func, std::size_t min_chunk_size) {
+  std::size_t chunks = parallel_chunks(count, min_chunk_size);
+  // chunk boundaries only depend on count, so results are deterministic
+  auto chunk_begin = [count, chunks](std::size_t chunk) {
+    return count / chunks * chunk + std::min(chunk, count % chunks);
+  };
+
+  if (chunks <= 1 || thread_pool::in_worker()) {
+    for (std::size_t i = 0; i < chunks; ++i) {
+      func(i, chunk_begin(i), chunk_begin(i + 1));
+    }
+    return;
+  }
+
+  std::vector<std::future<void>> results{};
+  for (std::size_t i = 1; i < chunks; ++i) {
+    results.push_back(thread_pool::global().submit([&func, &chunk_begin, i](){
+      func(i, chunk_begin(i), chunk_begin(i + 1));
+    }));
+  }
+  std::exception_ptr error{};
+  try {
+    func(0, chunk_begin(0), chunk_begin(1));
+  }
+  catch (...) {
+    error = std::current_exception();
+  }
+  // wait for all chunks before rethrowing, they reference local state
+  for (auto& result : results) {
+    try {
+      result.get();
+    }
+    catch (...) {
+      if (!error) error = std::current_exception();
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
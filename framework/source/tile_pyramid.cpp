@@ -0,0 +1,182 @@
+#include "tile_pyramid.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// increase when the layout of the file or the texels written into it change
+static std::uint32_t const VERSION = 2;
+static char const MAGIC[4] = {'T', 'I', 'L', 'E'};
+// alignment of the first tile in the file
+static std::uint64_t const ALIGNMENT = 16;
+
+// fixed size file header, followed by level entries and the tiles of all levels in row order
+struct pyramid_header {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t tile_size;
+  std::uint32_t border;
+  // gl enums of the texel format
+  std::uint32_t channels;
+  std::uint32_t channel_type;
+  std::uint32_t level_num;
+  std::uint32_t padding;
+};
+
+struct level_entry {
+  std::uint64_t width;
+  std::uint64_t height;
+  std::uint64_t tiles_x;
+  std::uint64_t tiles_y;
+};
+
+static std::size_t component_num(GLenum channels) {
+  switch (channels) {
+    case GL_RED: return 1;
+    case GL_RG: return 2;
+    case GL_RGB: return 3;
+    case GL_RGBA: return 4;
+    default: throw std::invalid_argument("Unsupported channel format for tiles");
+  }
+}
+
+static std::uint64_t data_offset(std::size_t level_num) {
+  std::uint64_t offset = sizeof(pyramid_header) + level_num * sizeof(level_entry);
+  return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+tile_pyramid::tile_pyramid(std::string const& path)
+ :m_file{new mapped_file{path}}
+ ,m_levels{}
+ ,m_tile_size{0}
+ ,m_border{0}
+ ,m_tile_bytes{0}
+ ,m_data_offset{0}
+ ,m_channels{GL_NONE}
+ ,m_channel_type{GL_NONE}
+{
+  pyramid_header head;
+  if (m_file->size() < sizeof(pyramid_header)) {
+    throw std::runtime_error("Tile pyramid " + path + " is truncated");
+  }
+  std::memcpy(&head, m_file->data(), sizeof(pyramid_header));
+  if (std::memcmp(head.magic, MAGIC, sizeof(MAGIC)) != 0 || head.version != VERSION || head.level_num == 0) {
+    throw std::runtime_error("Tile pyramid " + path + " has an unknown format");
+  }
+  m_tile_size = head.tile_size;
+  m_border = head.border;
+  m_channels = GLenum(head.channels);
+  m_channel_type = GLenum(head.channel_type);
+  m_tile_bytes = padded_size() * padded_size() * component_num(m_channels);
+  m_data_offset = data_offset(head.level_num);
+
+  std::size_t tile_num = 0;
+  for (std::uint32_t i = 0; i < head.level_num; ++i) {
+    level_entry entry;
+    if (sizeof(pyramid_header) + (i + 1) * sizeof(level_entry) > m_file->size()) {
+      throw std::runtime_error("Tile pyramid " + path + " is truncated");
+    }
+    std::memcpy(&entry, m_file->data() + sizeof(pyramid_header) + i * sizeof(level_entry), sizeof(level_entry));
+    m_levels.push_back(level{std::size_t(entry.width), std::size_t(entry.height),
+                             std::size_t(entry.tiles_x), std::size_t(entry.tiles_y), tile_num});
+    tile_num += m_levels.back().tiles_x * m_levels.back().tiles_y;
+  }
+  if (m_data_offset + tile_num * m_tile_bytes > m_file->size()) {
+    throw std::runtime_error("Tile pyramid " + path + " is truncated");
+  }
+}
+
+// out of line, mapped_file is incomplete in the header
+tile_pyramid::~tile_pyramid() {}
+
+std::uint8_t const* tile_pyramid::tile(std::size_t level_index, std::size_t x, std::size_t y) const {
+  level const& mip = m_levels.at(level_index);
+  if (x >= mip.tiles_x || y >= mip.tiles_y) {
+    throw std::out_of_range("Tile outside of pyramid level");
+  }
+  return m_file->data() + m_data_offset + (mip.first_tile + y * mip.tiles_x + x) * m_tile_bytes;
+}
+
+void tile_pyramid::write(pixel_data const& image, std::string const& path, std::size_t tile_size, std::size_t border) {
+  if (image.compression != GL_NONE || image.channel_type != GL_UNSIGNED_BYTE || image.depth > 1) {
+    throw std::invalid_argument("Tiles need an uncompressed 2d image with unsigned byte channels");
+  }
+  if (tile_size == 0) {
+    throw std::invalid_argument("Tiles need at least one texel");
+  }
+  std::size_t components = component_num(image.channels);
+  std::size_t padded = tile_size + border * 2;
+
+  // levels down to the first which fits in one tile
+  std::vector<level_entry> entries{};
+  for (std::size_t l = 0; l < image.level_num(); ++l) {
+    pixel_data::mip_level const& mip = image.levels.at(l);
+    entries.push_back(level_entry{mip.width, mip.height, (mip.width + tile_size - 1) / tile_size, (mip.height + tile_size - 1) / tile_size});
+    if (entries.back().tiles_x == 1 && entries.back().tiles_y == 1) {
+      break;
+    }
+  }
+  if (entries.back().tiles_x > 1 || entries.back().tiles_y > 1) {
+    throw std::invalid_argument("Tiles need a mip chain down to a level which fits in one tile");
+  }
+
+  pyramid_header head;
+  std::memset(&head, 0, sizeof(pyramid_header));
+  std::memcpy(head.magic, MAGIC, sizeof(MAGIC));
+  head.version = VERSION;
+  head.tile_size = std::uint32_t(tile_size);
+  head.border = std::uint32_t(border);
+  head.channels = std::uint32_t(image.channels);
+  head.channel_type = std::uint32_t(image.channel_type);
+  head.level_num = std::uint32_t(entries.size());
+
+  // write to temporary file and rename, so no partial pyramid is ever mapped
+  std::string temp_path{path + ".tmp"};
+  {
+    std::ofstream ofile(temp_path, std::ios::binary | std::ios::trunc);
+    if (!ofile) {
+      throw std::runtime_error("Tile pyramid " + path + " not writable");
+    }
+    ofile.write(reinterpret_cast<char const*>(&head), sizeof(pyramid_header));
+    ofile.write(reinterpret_cast<char const*>(entries.data()), std::streamsize(entries.size() * sizeof(level_entry)));
+    char const padding[ALIGNMENT] = {0};
+    ofile.write(padding, std::streamsize(data_offset(entries.size()) - sizeof(pyramid_header) - entries.size() * sizeof(level_entry)));
+
+    std::vector<std::uint8_t> tile(padded * padded * components);
+    for (std::size_t l = 0; l < entries.size(); ++l) {
+      std::size_t width = std::size_t(entries[l].width);
+      std::size_t height = std::size_t(entries[l].height);
+      std::uint8_t const* texels = static_cast<std::uint8_t const*>(image.ptr(l));
+      for (std::size_t tile_y = 0; tile_y < entries[l].tiles_y; ++tile_y) {
+        for (std::size_t tile_x = 0; tile_x < entries[l].tiles_x; ++tile_x) {
+          // border and texels outside the level wrap around horizontally, the image is an equirectangular map
+          // with a seam at u = 0 and u = 1, and repeat the nearest row at the poles
+          for (std::size_t y = 0; y < padded; ++y) {
+            long source_y = long(tile_y * tile_size + y) - long(border);
+            std::size_t row = std::size_t(std::max(0l, std::min(long(height) - 1, source_y)));
+            for (std::size_t x = 0; x < padded; ++x) {
+              long source_x = long(tile_x * tile_size + x) - long(border);
+              std::size_t column = std::size_t((source_x % long(width) + long(width)) % long(width));
+              std::memcpy(&tile[(y * padded + x) * components], texels + (row * width + column) * components, components);
+            }
+          }
+          ofile.write(reinterpret_cast<char const*>(tile.data()), std::streamsize(tile.size()));
+        }
+      }
+    }
+    if (!ofile) {
+      ofile.close();
+      std::remove(temp_path.c_str());
+      throw std::runtime_error("Tile pyramid " + path + " could not be written");
+    }
+  }
+  // rename does not replace existing files on windows
+  std::remove(path.c_str());
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+    throw std::runtime_error("Tile pyramid " + path + " could not be renamed");
+  }
+}
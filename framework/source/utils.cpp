@@ -1,25 +1,144 @@
 #include "utils.hpp"
 #include "pixel_data.hpp"
+#include "model.hpp"
 #include "structs.hpp"
+#include "texture_loader.hpp"
 
 #include <glbinding/gl/functions.h>
+#include <glbinding/gl/extension.h>
+#include <glbinding/ContextInfo.h>
+#include <glbinding/Version.h>
 // use gl definitions from glbinding 
 using namespace gl;
 
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <set>
+#include <stdexcept>
 
 namespace utils {
 
 texture_object create_texture_object(pixel_data const& tex) {
+  // images without mip chain get one filtered on the cpu, compressed blocks and layers can not be filtered
+  pixel_data mipmapped{};
+  pixel_data const* image = &tex;
+  if (tex.level_num() < 2 && (tex.width > 1 || tex.height > 1) && tex.compression == GL_NONE && tex.depth < 2) {
+    mipmapped = tex;
+    texture_loader::generate_mipmaps(mipmapped);
+    image = &mipmapped;
+  }
+
   texture_object t_obj{};
+  // several layers make an array texture
+  t_obj.target = tex.depth > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+  // bind to the active unit
+  glGenTextures(1, &t_obj.handle);
+  glBindTexture(t_obj.target, t_obj.handle);
+  glTexParameteri(t_obj.target, GL_TEXTURE_MIN_FILTER, image->level_num() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(t_obj.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(t_obj.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(t_obj.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(t_obj.target, GL_TEXTURE_MAX_LEVEL, GLint(image->level_num() - 1));
+  for (std::size_t level = 0; level < image->level_num(); ++level) {
+    tex_image(t_obj.target, *image, level);
+  }
 
-  throw std::logic_error("Texture Object creation not implemented yet");
+  return t_obj;
+}
+
+texture_object create_cube_map_object(pixel_data const& faces) {
+  if (faces.depth != 6 || faces.width != faces.height) {
+    throw std::invalid_argument("Cube map needs six square layers");
+  }
+  texture_object t_obj{};
+  t_obj.target = GL_TEXTURE_CUBE_MAP;
+  // bind to the active unit
+  glGenTextures(1, &t_obj.handle);
+  glBindTexture(t_obj.target, t_obj.handle);
+  glTexParameteri(t_obj.target, GL_TEXTURE_MIN_FILTER, faces.level_num() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(t_obj.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(t_obj.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(t_obj.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(t_obj.target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glTexParameteri(t_obj.target, GL_TEXTURE_MAX_LEVEL, GLint(faces.level_num() - 1));
+  // rows of odd width are not 4 byte aligned
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (std::size_t level = 0; level < faces.level_num(); ++level) {
+    pixel_data::mip_level mip{0, faces.pixels.size(), faces.width, faces.height};
+    if (!faces.levels.empty()) {
+      mip = faces.levels.at(level);
+    }
+    // faces are consecutive in a level
+    std::size_t face_bytes = mip.bytes / 6;
+    for (std::size_t face = 0; face < 6; ++face) {
+      GLenum target = GLenum(static_cast<unsigned int>(GL_TEXTURE_CUBE_MAP_POSITIVE_X) + face);
+      void const* texels = static_cast<std::uint8_t const*>(faces.ptr(level)) + face * face_bytes;
+      if (faces.compression != GL_NONE) {
+        glCompressedTexImage2D(target, GLint(level), faces.compression, GLsizei(mip.width), GLsizei(mip.height), 0,
+                               GLsizei(face_bytes), texels);
+      }
+      else {
+        glTexImage2D(target, GLint(level), faces.channels, GLsizei(mip.width), GLsizei(mip.height), 0,
+                     faces.channels, faces.channel_type, texels);
+      }
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
   return t_obj;
 }
 
+void tex_image(GLenum target, pixel_data const& tex, std::size_t level, std::size_t base_level) {
+  pixel_data::mip_level mip{0, tex.pixels.size(), tex.width, tex.height};
+  if (!tex.levels.empty()) {
+    mip = tex.levels.at(level);
+  }
+  // layers are consecutive in a level
+  bool layered = target == GL_TEXTURE_2D_ARRAY;
+  if (tex.compression != GL_NONE) {
+    if (layered) {
+      glCompressedTexImage3D(target, GLint(level - base_level), tex.compression, GLsizei(mip.width), GLsizei(mip.height), GLsizei(tex.depth), 0,
+                             GLsizei(mip.bytes), tex.ptr(level));
+    }
+    else {
+      glCompressedTexImage2D(target, GLint(level - base_level), tex.compression, GLsizei(mip.width), GLsizei(mip.height), 0,
+                             GLsizei(mip.bytes), tex.ptr(level));
+    }
+    return;
+  }
+  // rows of odd width are not 4 byte aligned
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  if (layered) {
+    glTexImage3D(target, GLint(level - base_level), tex.channels, GLsizei(mip.width), GLsizei(mip.height), GLsizei(tex.depth), 0,
+                 tex.channels, tex.channel_type, tex.ptr(level));
+  }
+  else {
+    glTexImage2D(target, GLint(level - base_level), tex.channels, GLsizei(mip.width), GLsizei(mip.height), 0,
+                 tex.channels, tex.channel_type, tex.ptr(level));
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+bool supports_compression(GLenum internal_format) {
+  std::set<GLextension> extensions = glbinding::ContextInfo::extensions();
+  glbinding::Version version = glbinding::ContextInfo::version();
+  switch (internal_format) {
+    case GL_NONE:
+      return true;
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+      return extensions.count(GLextension::GL_EXT_texture_compression_s3tc) > 0;
+    case GL_COMPRESSED_RG_RGTC2:
+      return version >= glbinding::Version(3, 0) || extensions.count(GLextension::GL_ARB_texture_compression_rgtc) > 0;
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+      return version >= glbinding::Version(4, 2) || extensions.count(GLextension::GL_ARB_texture_compression_bptc) > 0;
+    default:
+      return false;
+  }
+}
+
 void print_bound_textures() {
   GLint id1, id2, id3, active_unit, texture_units = 0;
   glGetIntegerv(GL_ACTIVE_TEXTURE, &active_unit);
@@ -89,6 +208,11 @@ GLint get_bound_VAO() {
   return array;
 }
 
+void vertex_attrib_pointer(GLuint location, model const& source, int attribute) {
+  model::attribute const& layout = source.offsets.at(attribute);
+  glVertexAttribPointer(location, layout.components, layout.type, layout.normalized, source.vertex_bytes, layout.offset);
+}
+
 std::string file_name(std::string const& file_path) {
   return file_path.substr(file_path.find_last_of("/\\") + 1);
 }
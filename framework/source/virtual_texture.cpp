@@ -0,0 +1,321 @@
+#include "virtual_texture.hpp"
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/matrix.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+virtual_texture::virtual_texture(std::string const& pyramid_path, std::size_t pages_per_side)
+ :m_pyramid{pyramid_path}
+ ,m_pages_per_side{pages_per_side}
+ ,m_cache{}
+ ,m_indirection{}
+ ,m_indirection_texels{}
+ ,m_resident{}
+ ,m_lru{}
+ ,m_free_pages{}
+ ,m_requested{}
+ ,m_frame{0}
+ ,m_mutex{}
+ ,m_condition{}
+ ,m_queue{}
+ ,m_loaded{}
+ ,m_pending{}
+ ,m_stop{false}
+ ,m_streamer{}
+{
+  // pages are addressed by 8 bit indirection texels
+  if (pages_per_side == 0 || pages_per_side > 256) {
+    throw std::invalid_argument("Virtual texture needs between 1 and 256 pages per side");
+  }
+  if (m_pyramid.channel_type() != GL_UNSIGNED_BYTE) {
+    throw std::invalid_argument("Virtual texture needs unsigned byte tiles");
+  }
+
+  // bound to the active unit
+  m_cache.target = GL_TEXTURE_2D;
+  glGenTextures(1, &m_cache.handle);
+  glBindTexture(m_cache.target, m_cache.handle);
+  glTexParameteri(m_cache.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(m_cache.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(m_cache.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(m_cache.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(m_cache.target, GL_TEXTURE_MAX_LEVEL, 0);
+  glTexImage2D(m_cache.target, 0, m_pyramid.channels(), GLsizei(cache_size()), GLsizei(cache_size()), 0,
+               m_pyramid.channels(), m_pyramid.channel_type(), nullptr);
+
+  // layer per level with the tile grid of the finest level
+  tile_pyramid::level const& finest = m_pyramid.levels().front();
+  m_indirection.target = GL_TEXTURE_2D_ARRAY;
+  glGenTextures(1, &m_indirection.handle);
+  glBindTexture(m_indirection.target, m_indirection.handle);
+  glTexParameteri(m_indirection.target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(m_indirection.target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(m_indirection.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(m_indirection.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(m_indirection.target, GL_TEXTURE_MAX_LEVEL, 0);
+  glTexImage3D(m_indirection.target, 0, GL_RGBA8UI, GLsizei(finest.tiles_x), GLsizei(finest.tiles_y),
+               GLsizei(m_pyramid.levels().size()), 0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+  m_indirection_texels.resize(finest.tiles_x * finest.tiles_y * m_pyramid.levels().size() * 4, 0);
+
+  // the coarsest level is pinned to the first page, so every texel has a resident tile
+  std::size_t page_num = pages_per_side * pages_per_side;
+  for (std::size_t page = page_num; page > 1; --page) {
+    m_free_pages.push_back(page - 1);
+  }
+  std::size_t coarsest = m_pyramid.levels().size() - 1;
+  upload(0, m_pyramid.tile(coarsest, 0, 0));
+  m_resident.emplace(tile_id(coarsest, 0, 0), resident_tile{0, m_lru.end(), true, 0});
+  update_indirection();
+
+  m_streamer = std::thread{&virtual_texture::stream, this};
+}
+
+virtual_texture::~virtual_texture() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  m_streamer.join();
+
+  glDeleteTextures(1, &m_cache.handle);
+  glDeleteTextures(1, &m_indirection.handle);
+}
+
+std::size_t virtual_texture::tile_id(std::size_t level, std::size_t x, std::size_t y) const {
+  tile_pyramid::level const& mip = m_pyramid.levels()[level];
+  return mip.first_tile + y * mip.tiles_x + x;
+}
+
+void virtual_texture::tile_position(std::size_t id, std::size_t& level, std::size_t& x, std::size_t& y) const {
+  std::vector<tile_pyramid::level> const& levels = m_pyramid.levels();
+  level = 0;
+  while (level + 1 < levels.size() && levels[level + 1].first_tile <= id) {
+    ++level;
+  }
+  std::size_t index = id - levels[level].first_tile;
+  x = index % levels[level].tiles_x;
+  y = index / levels[level].tiles_x;
+}
+
+void virtual_texture::request(std::size_t level, std::size_t x, std::size_t y) {
+  std::size_t id = tile_id(level, x, y);
+  auto resident = m_resident.find(id);
+  if (resident == m_resident.end()) {
+    m_requested.push_back(id);
+    return;
+  }
+  if (!resident->second.pinned) {
+    m_lru.splice(m_lru.begin(), m_lru, resident->second.use);
+    resident->second.frame = m_frame;
+  }
+}
+
+// largest cosine between direction and the points of the meridian at phi between theta_min and theta_max
+static float meridian_cosine(glm::fvec3 const& direction, float phi, float theta_min, float theta_max) {
+  // dot product is a * sin(theta) + b * cos(theta), extremal at the ends and at atan(a / b)
+  float a = direction.x * std::sin(phi) + direction.z * std::cos(phi);
+  float b = direction.y;
+  float theta = std::max(theta_min, std::min(theta_max, std::atan2(a, b)));
+  float cosine = a * std::sin(theta) + b * std::cos(theta);
+  cosine = std::max(cosine, a * std::sin(theta_min) + b * std::cos(theta_min));
+  return std::max(cosine, a * std::sin(theta_max) + b * std::cos(theta_max));
+}
+
+void virtual_texture::request_sphere(glm::fmat4 const& model_matrix, glm::fvec3 const& camera_position, float pixels_per_unit) {
+  std::vector<tile_pyramid::level> const& levels = m_pyramid.levels();
+  // camera on the unit sphere, in units of the radius
+  glm::fvec3 camera{glm::inverse(model_matrix) * glm::fvec4{camera_position, 1.0f}};
+  float camera_distance = glm::length(camera);
+  if (camera_distance <= 1.0f) {
+    return;
+  }
+  glm::fvec3 direction{camera / camera_distance};
+  float camera_phi = std::atan2(direction.x, direction.z);
+  camera_phi = camera_phi < 0.0f ? camera_phi + glm::two_pi<float>() : camera_phi;
+  float tile_size = float(m_pyramid.tile_size());
+  // the coarsest tile is always resident, refinement stops when the cache would overflow
+  std::size_t budget = m_pages_per_side * m_pages_per_side - 1;
+
+  struct candidate {
+    std::size_t level;
+    std::size_t x;
+    std::size_t y;
+  };
+  std::deque<candidate> candidates{candidate{levels.size() - 1, 0, 0}};
+  while (!candidates.empty() && budget > 0) {
+    candidate tile = candidates.front();
+    candidates.pop_front();
+    tile_pyramid::level const& mip = levels[tile.level];
+
+    // texcoords of the sphere are longitude and latitude, so tiles are rectangles in those
+    float phi_min = glm::two_pi<float>() * std::min(1.0f, float(tile.x) * tile_size / float(mip.width));
+    float phi_max = glm::two_pi<float>() * std::min(1.0f, float(tile.x + 1) * tile_size / float(mip.width));
+    float theta_min = glm::pi<float>() * (1.0f - std::min(1.0f, float(tile.y + 1) * tile_size / float(mip.height)));
+    float theta_max = glm::pi<float>() * (1.0f - std::min(1.0f, float(tile.y) * tile_size / float(mip.height)));
+    // point of the tile closest to the camera direction lies on a border meridian or the camera meridian
+    float cosine = std::max(meridian_cosine(direction, phi_min, theta_min, theta_max),
+                            meridian_cosine(direction, phi_max, theta_min, theta_max));
+    if (camera_phi >= phi_min && camera_phi <= phi_max) {
+      cosine = std::max(cosine, meridian_cosine(direction, camera_phi, theta_min, theta_max));
+    }
+    // tiles behind the horizon are hidden
+    if (cosine * camera_distance <= 1.0f) {
+      continue;
+    }
+    request(tile.level, tile.x, tile.y);
+    --budget;
+
+    // refine if a texel at the closest point covers more than a pixel, latitude spans half the circumference
+    float distance = std::sqrt(std::max(camera_distance * camera_distance - 2.0f * camera_distance * cosine + 1.0f, 1e-12f));
+    float texel_pixels = glm::pi<float>() / float(mip.height) / distance * pixels_per_unit;
+    if (tile.level > 0 && texel_pixels > 1.0f) {
+      tile_pyramid::level const& finer = levels[tile.level - 1];
+      for (std::size_t y = tile.y * 2; y < std::min(tile.y * 2 + 2, finer.tiles_y); ++y) {
+        for (std::size_t x = tile.x * 2; x < std::min(tile.x * 2 + 2, finer.tiles_x); ++x) {
+          candidates.push_back(candidate{tile.level - 1, x, y});
+        }
+      }
+    }
+  }
+}
+
+void virtual_texture::update(std::size_t max_uploads) {
+  std::vector<loaded_tile> loaded{};
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    loaded.swap(m_loaded);
+    for (auto const& tile : loaded) {
+      m_pending.erase(tile.id);
+    }
+  }
+
+  bool changed = false;
+  std::size_t uploads = 0;
+  for (auto const& tile : loaded) {
+    if (uploads == max_uploads) {
+      // dropped tiles are queued again while they are requested
+      break;
+    }
+    std::size_t page = 0;
+    if (m_resident.count(tile.id) > 0 || !allocate_page(page)) {
+      continue;
+    }
+    upload(page, tile.texels.data());
+    m_lru.push_front(tile.id);
+    m_resident.emplace(tile.id, resident_tile{page, m_lru.begin(), false, m_frame});
+    changed = true;
+    ++uploads;
+  }
+  if (changed) {
+    update_indirection();
+  }
+
+  // only tiles requested in this frame are worth streaming, in the order of the requests
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    for (std::size_t id : m_queue) {
+      m_pending.erase(id);
+    }
+    m_queue.clear();
+    for (std::size_t id : m_requested) {
+      if (m_resident.count(id) == 0 && m_pending.insert(id).second) {
+        m_queue.push_back(id);
+      }
+    }
+  }
+  m_condition.notify_one();
+  m_requested.clear();
+  ++m_frame;
+}
+
+void virtual_texture::upload(std::size_t page, std::uint8_t const* texels) {
+  std::size_t padded = m_pyramid.padded_size();
+  glBindTexture(m_cache.target, m_cache.handle);
+  // rows of odd width are not 4 byte aligned
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(m_cache.target, 0, GLint(page % m_pages_per_side * padded), GLint(page / m_pages_per_side * padded),
+                  GLsizei(padded), GLsizei(padded), m_pyramid.channels(), m_pyramid.channel_type(), texels);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+bool virtual_texture::allocate_page(std::size_t& page) {
+  if (!m_free_pages.empty()) {
+    page = m_free_pages.back();
+    m_free_pages.pop_back();
+    return true;
+  }
+  if (m_lru.empty()) {
+    return false;
+  }
+  auto oldest = m_resident.find(m_lru.back());
+  // tiles requested in this frame are visible
+  if (oldest->second.frame == m_frame) {
+    return false;
+  }
+  page = oldest->second.page;
+  m_resident.erase(oldest);
+  m_lru.pop_back();
+  return true;
+}
+
+void virtual_texture::update_indirection() {
+  std::vector<tile_pyramid::level> const& levels = m_pyramid.levels();
+  std::size_t grid_width = levels.front().tiles_x;
+  std::size_t layer_size = grid_width * levels.front().tiles_y;
+  // coarse to fine, tiles without resident texels use the entry of their parent
+  for (std::size_t l = levels.size(); l > 0; --l) {
+    std::size_t level = l - 1;
+    for (std::size_t y = 0; y < levels[level].tiles_y; ++y) {
+      for (std::size_t x = 0; x < levels[level].tiles_x; ++x) {
+        std::uint8_t* entry = &m_indirection_texels[(level * layer_size + y * grid_width + x) * 4];
+        auto resident = m_resident.find(tile_id(level, x, y));
+        if (resident != m_resident.end()) {
+          entry[0] = std::uint8_t(resident->second.page % m_pages_per_side);
+          entry[1] = std::uint8_t(resident->second.page / m_pages_per_side);
+          entry[2] = std::uint8_t(level);
+          entry[3] = 255;
+        }
+        else {
+          std::size_t parent_x = std::min(x / 2, levels[level + 1].tiles_x - 1);
+          std::size_t parent_y = std::min(y / 2, levels[level + 1].tiles_y - 1);
+          std::uint8_t const* parent = &m_indirection_texels[((level + 1) * layer_size + parent_y * grid_width + parent_x) * 4];
+          std::copy(parent, parent + 4, entry);
+        }
+      }
+    }
+  }
+  glBindTexture(m_indirection.target, m_indirection.handle);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage3D(m_indirection.target, 0, 0, 0, 0, GLsizei(grid_width), GLsizei(levels.front().tiles_y),
+                  GLsizei(levels.size()), GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, m_indirection_texels.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void virtual_texture::stream() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+  while (true) {
+    m_condition.wait(lock, [this]{ return m_stop || !m_queue.empty(); });
+    if (m_stop) {
+      return;
+    }
+    std::size_t id = m_queue.front();
+    m_queue.pop_front();
+    lock.unlock();
+
+    // reading the mapping faults the tile in from disk outside of the render thread
+    std::size_t level = 0;
+    std::size_t x = 0;
+    std::size_t y = 0;
+    tile_position(id, level, x, y);
+    std::uint8_t const* texels = m_pyramid.tile(level, x, y);
+    loaded_tile tile{id, std::vector<std::uint8_t>(texels, texels + m_pyramid.tile_bytes())};
+
+    lock.lock();
+    m_loaded.push_back(std::move(tile));
+  }
+}
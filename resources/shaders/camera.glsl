@@ -0,0 +1,9 @@
+// camera matrices shared by all programs, written once per frame by camera_buffer
+layout(std140) uniform Camera {
+  mat4 ViewMatrix;
+  mat4 ProjectionMatrix;
+  mat4 ViewProjectionMatrix;
+  mat4 InverseViewMatrix;
+  mat4 InverseProjectionMatrix;
+  mat4 InverseViewProjectionMatrix;
+};
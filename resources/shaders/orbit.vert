@@ -5,9 +5,8 @@ layout(location = 0) in vec3 in_Position;
 
 //Matrix Uniforms as specified with glUniformMatrix4fv
 uniform mat4 ModelMatrix;
-uniform mat4 ViewMatrix;
-uniform mat4 ProjectionMatrix;
+#include "camera.glsl"
 
 void main(void) {
-	gl_Position = (ProjectionMatrix * ViewMatrix * ModelMatrix) * vec4(in_Position, 1.0);
+	gl_Position = (ViewProjectionMatrix * ModelMatrix) * vec4(in_Position, 1.0);
 }
@@ -5,11 +5,7 @@ in vec2 texture_Coordinates;
 
 uniform sampler2D FramebufferTex;
 
-uniform bool HorizontalReflectionMode;
-uniform bool GreyScaleMode;
-uniform bool VerticalReflectionMode;
-uniform bool BlurMode;
-uniform bool GodRays;
+// effects are selected by defining GODRAYS, HORIZONTAL_REFLECTION, VERTICAL_REFLECTION, BLUR and GREYSCALE
 uniform vec4 LightCenter;
 uniform sampler2D LightTex;
 
@@ -27,7 +23,8 @@ void main() {
 
   out_Color = texture(FramebufferTex, texture_Coordinates);
 
-  if (GodRays) {
+#ifdef GODRAYS
+  {
     float exposure = 0.75;
     float decay = 0.97;
     float density = 0.5;
@@ -49,18 +46,20 @@ void main() {
    }
    out_Color = final_Light * exposure;
   }
+#endif
 
-  if (HorizontalReflectionMode) {
-    // horizontal
-		tex_y = 1 - tex_y;
-		out_Color = texture(FramebufferTex, vec2(tex_x, tex_y));
-  }
-  if (VerticalReflectionMode) {
-    // vertical
-    tex_x = 1 - tex_x;
-		out_Color = texture(FramebufferTex, vec2(tex_x, tex_y));
-  }
-  if (BlurMode) {
+#ifdef HORIZONTAL_REFLECTION
+  // horizontal
+	tex_y = 1 - tex_y;
+	out_Color = texture(FramebufferTex, vec2(tex_x, tex_y));
+#endif
+#ifdef VERTICAL_REFLECTION
+  // vertical
+  tex_x = 1 - tex_x;
+	out_Color = texture(FramebufferTex, vec2(tex_x, tex_y));
+#endif
+#ifdef BLUR
+  {
     // blur
     float temp_x = 1.0 / 1024;
     float temp_y = 1.0 / 768;
@@ -83,9 +82,10 @@ void main() {
     }
     out_Color = sum;
   }
-  if(GreyScaleMode) {
-    // greyscale
-    float avg = 0.2126 * out_Color.r + 0.7152 * out_Color.g + 0.0722 * out_Color.b;
-    out_Color = vec4(avg, avg, avg, 1.0);
-  }
+#endif
+#ifdef GREYSCALE
+  // greyscale
+  float avg = 0.2126 * out_Color.r + 0.7152 * out_Color.g + 0.0722 * out_Color.b;
+  out_Color = vec4(avg, avg, avg, 1.0);
+#endif
 }
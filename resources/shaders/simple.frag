@@ -10,49 +10,109 @@ in vec2 texture_Coordinates;
 in vec3 vertex_Position_Cam;
 in vec3 light_Position;
 
-uniform sampler2D ColorTex;
+// planet textures are layers of an array, smaller ones cover a part of their layer
+uniform sampler2DArray ColorTex;
+uniform int ColorLayer;
+uniform vec2 ColorScale;
 uniform sampler2D NormalTex;
-
-flat in int shader_Mode;
+// streamed planet textures, cache pages of tiles located through an indirection layer per level
+uniform bool VirtualColor;
+uniform sampler2D VirtualCache;
+uniform usampler2DArray VirtualIndirection;
+uniform vec2 VirtualSize;
+// tile size and border in texels, cache size in texels
+uniform vec3 VirtualTile;
+uniform int VirtualLevels;
 
 out vec4 out_Color;
 
-// switch between viewing-modi
+// Blinn-Phong shading, or cell shading if TOON is defined
 
 // const vec3 light_Position = vec3(0.0, 0.0, 0.0);
 const vec3 specular_Color = vec3(1.0, 1.0, 1.0); // color of the specular highlights
+// sample the finest resident tile at the level matching the screen footprint
+vec4 virtualTexture(vec2 uv) {
+  vec2 texel = uv * VirtualSize;
+  vec2 footprint = max(abs(dFdx(texel)), abs(dFdy(texel)));
+  float level = clamp(floor(log2(max(max(footprint.x, footprint.y), 1.0))), 0.0, float(VirtualLevels - 1));
+  vec2 level_Size = max(floor(VirtualSize / exp2(level)), vec2(1.0));
+  ivec2 tile_Num = ivec2(ceil(level_Size / VirtualTile.x));
+  ivec2 tile = clamp(ivec2(uv * level_Size / VirtualTile.x), ivec2(0), tile_Num - 1);
+  uvec4 entry = texelFetch(VirtualIndirection, ivec3(tile, int(level)), 0);
+
+  // position inside the resident tile, which may be coarser than requested
+  vec2 resident_Size = max(floor(VirtualSize / exp2(float(entry.b))), vec2(1.0));
+  vec2 resident_Texel = clamp(uv * resident_Size, vec2(0.0), resident_Size);
+  vec2 resident_Tile = min(floor(resident_Texel / VirtualTile.x), ceil(resident_Size / VirtualTile.x) - 1.0);
+  vec2 offset = resident_Texel - resident_Tile * VirtualTile.x;
+  float padded = VirtualTile.x + 2.0 * VirtualTile.y;
+  vec2 cache_Texel = vec2(entry.rg) * padded + VirtualTile.y + offset;
+  return texture(VirtualCache, cache_Texel / VirtualTile.z);
+}
+
+vec3 surfaceColor() {
+  if (VirtualColor) {
+    return virtualTexture(texture_Coordinates).rgb;
+  }
+  return texture(ColorTex, vec3(texture_Coordinates * ColorScale, ColorLayer)).rgb;
+}
+
 // const vec3 ambient_Color = vec3(0.01, 0.01, 0.01);  // indirect light coming from sourroundings
-vec3 ambient_Color = vec3(texture(ColorTex, texture_Coordinates)).xyz * 0.01;  // indirect light coming from sourroundings
+vec3 ambient_Color = surfaceColor() * 0.01;  // indirect light coming from sourroundings
 // const vec3 diffuse_Color = vec3(0.5, 0.5, 0.5);  // diffusely reflected light from surface microfacets
-vec3 diffuse_Color = vec3(texture(ColorTex, texture_Coordinates)).xyz;  // diffusely reflected light from surface microfacets
+vec3 diffuse_Color = surfaceColor();  // diffusely reflected light from surface microfacets
 // const float sun_Intensity = 1.0;
 // const float ambient_Intensity = 0.01;
 // const float diffuse_Intensity = 0.5;
 // const float specular_Intensity = 1.0;
 const float shininess = 16.0;
 const float screen_Gamma = 2.2;
-vec3 normal_Mapping = 2 * texture(NormalTex, texture_Coordinates).rgb - 1.0f;
+// normal map stores x and y only (bc5), z is reconstructed
+vec2 normal_XY = 2 * texture(NormalTex, texture_Coordinates).rg - 1.0f;
+vec3 normal_Mapping = vec3(normal_XY, sqrt(max(1.0 - dot(normal_XY, normal_XY), 0.0)));
 
 void main() {
+  vec3 L  = normalize(light_Position - vertex_Position); // light direction
+  vec3 V  = normalize(-vertex_Position); // view direction
+  vec3 H  = normalize(L + V); // halfway vector
+  vec3 color_Linear;
+
+#ifdef TOON
+  // Cell-Shading-Model
+  vec3 N = normalize(pass_Normal); // normal
+  float normal_View_Angle = dot(-normalize(vertex_Position), N);
+
+  diffuse_Color = planet_Color;
+  ambient_Color = vec3(0.01, 0.01, 0.01);
+
+  float specular_Angle = max(dot(H, N), 0.0); // rho
+  float specular = pow(specular_Angle, shininess * 10); // reflection of light directly to viewer
+  float lambertian = max(dot(L, N), 0.0); // diffuse reflectance
+
+  if(lambertian > 0.9) {lambertian = 1;}
+  else if(lambertian > 0.6) {lambertian = 0.9;}
+  else if(lambertian > 0.3) {lambertian = 0.6;}
+  else if(lambertian > 0.0) {lambertian = 0.3;}
+
+  // highlight the planets border in a different color
+  if(abs(normal_View_Angle) < 0.3) {
+    color_Linear = vec3(1.0, 0.0, 0.0);
+  } else {
+    // calculate planet color
+    color_Linear = ambient_Color + lambertian * diffuse_Color + specular * specular_Color;
+  }
+#else
   // normal mapping
   vec3 bi_Tangent = cross(pass_Normal, pass_Tangent);
   mat3 TangentMatrix = mat3(pass_Tangent, bi_Tangent, pass_Normal);
   vec3 normal = normalize(TangentMatrix * normal_Mapping); // detail normal
-  // vec3 N  = normalize(normal); // normal
-  // vec3 NV = normalize(pass_Normal_View); // normal view
-  vec3 L  = normalize(light_Position - vertex_Position); // light direction
-  vec3 V  = normalize(-vertex_Position); // view direction
-
 
   // Blinn-Phong-Model
   float lambertian = max(dot(L, normal), 0.0); // diffuse reflectance
 
-  vec3 H  = normalize(L + V); // halfway vector
-
   float specular_Angle = max(dot(H, normal), 0.0); // rho
   float specular = 0.0; // reflection of light directly to viewer
 
-
   // calculate specular reflection if the surface is oriented to the light source
   if(lambertian > 0.0) {
     specular = pow(specular_Angle, shininess * 10);
@@ -60,33 +120,8 @@ void main() {
 
   // calculate planet color
   // color_Linear = ambient_Color + lambertian * diffuse_Color * vec3(planet_Color).xyz + specular * specular_Color;
-  vec3 color_Linear = ambient_Color + lambertian * diffuse_Color + specular * specular_Color;
-
-  // Cell-Shading-Model
-  if (shader_Mode == 2) {
-
-    float normal_View_Angle = dot(-normalize(vertex_Position), normalize(pass_Normal));
-
-    diffuse_Color = planet_Color;
-    ambient_Color = vec3(0.01, 0.01, 0.01);
-
-    specular_Angle = max(dot(H, normalize(pass_Normal)), 0.0);
-    specular = pow(specular_Angle, shininess * 10);
-    lambertian = max(dot(L, normalize(pass_Normal)), 0.0);
-
-    if(lambertian > 0.9) {lambertian = 1;}
-    else if(lambertian > 0.6) {lambertian = 0.9;}
-    else if(lambertian > 0.3) {lambertian = 0.6;}
-    else if(lambertian > 0.0) {lambertian = 0.3;}
-
-    // highlight the planets border in a different color
-    if(abs(normal_View_Angle) < 0.3) {
-      color_Linear = vec3(1.0, 0.0, 0.0);
-    } else {
-      // calculate planet color
-      color_Linear = ambient_Color + lambertian * diffuse_Color + specular * specular_Color;
-    }
-  }
+  color_Linear = ambient_Color + lambertian * diffuse_Color + specular * specular_Color;
+#endif
 
   // calculate gamme correction
   vec3 color_Gamma_Corrected = pow(color_Linear, vec3(1.0/screen_Gamma));
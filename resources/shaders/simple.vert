@@ -3,20 +3,17 @@
 
 // vertex attributes of VAO
 layout(location = 0) in vec3 in_Position;
-layout(location = 1) in vec3 in_Normal;
+layout(location = 1) in vec2 in_Normal;
 layout(location = 2) in vec2 in_Texture_Coordinates;
-layout(location = 3) in vec3 in_Tangent;
+layout(location = 3) in vec2 in_Tangent;
 
 // Matrix Uniforms as specified with glUniformMatrix4fv
 uniform mat4 ModelMatrix;
-uniform mat4 ViewMatrix;
-uniform mat4 ProjectionMatrix;
 uniform mat4 NormalMatrix;
+#include "camera.glsl"
 
 uniform vec3 ColorVector;
 
-uniform int ShaderMode;
-
 out vec3 pass_Normal;
 // out vec3 pass_Normal_View;
 out vec3 pass_Tangent;
@@ -26,14 +23,15 @@ out vec3 planet_Color;
 out vec2 texture_Coordinates;
 out vec3 vertex_Position_Cam;
 out vec3 light_Position;
-flat out int shader_Mode;
 
 
+#include "octahedral.glsl"
+
 void main(void) {
-	gl_Position = (ProjectionMatrix * ViewMatrix * ModelMatrix) * vec4(in_Position, 1.0);
-	pass_Normal = (NormalMatrix * vec4(in_Normal, 0.0)).xyz;
+	gl_Position = (ViewProjectionMatrix * ModelMatrix) * vec4(in_Position, 1.0);
+	pass_Normal = (NormalMatrix * vec4(decode_octahedral(in_Normal), 0.0)).xyz;
 	// pass_Normal_View = (ViewMatrix * vec4(pass_Normal, 0.0)).xyz;
-	pass_Tangent = (NormalMatrix * vec4(in_Tangent, 0.0)).xyz;
+	pass_Tangent = (NormalMatrix * vec4(decode_octahedral(in_Tangent), 0.0)).xyz;
 
 	vec4 vertex_Position4 = ViewMatrix * ModelMatrix * vec4(in_Position, 1.0);
 	vertex_Position = vertex_Position4.xyz / vertex_Position4.w;
@@ -46,5 +44,4 @@ void main(void) {
 	// transfer user input
 	planet_Color = ColorVector;
 	texture_Coordinates = in_Texture_Coordinates;
-	shader_Mode = ShaderMode;
 }
@@ -4,13 +4,11 @@
 layout(location = 0) in vec3 in_Position;
 layout(location = 1) in vec3 in_Color;
 
-//Matrix Uniforms as specified with glUniformMatrix4fv
-uniform mat4 ViewMatrix;
-uniform mat4 ProjectionMatrix;
+#include "camera.glsl"
 
 out vec3 pass_Color;
 
 void main(void) {
-	gl_Position = (ProjectionMatrix * ViewMatrix) * vec4(in_Position, 1.0);
+	gl_Position = ViewProjectionMatrix * vec4(in_Position, 1.0);
 	pass_Color = in_Color;
 }
@@ -5,29 +5,30 @@ in vec3 vertex_Position;
 in vec3 sun_Color;
 in vec2 texture_Coordinates;
 
-uniform sampler2D ColorTex;
-flat in int shader_Mode;
+// planet textures are layers of an array, smaller ones cover a part of their layer
+uniform sampler2DArray ColorTex;
+uniform int ColorLayer;
+uniform vec2 ColorScale;
 
 out vec4 out_Color;
 
 void main() {
-  // Cell Shading Model
-  if (shader_Mode == 2) {
-    vec3 NV = normalize(pass_Normal); // normal view
-    vec3 color_Linear;
-    float normal_View_Angle = dot(-normalize(vertex_Position), NV);
-
-    // highlight suns border in a different color
-    if(abs(normal_View_Angle) < 0.1) {
-      color_Linear = vec3(1.0, 0.0, 0.0);
-    } else {
-      // set the sun color
-      color_Linear = vec3(sun_Color).xyz;
-    }
-    out_Color = vec4(color_Linear, 1.0);
+  // Cell Shading Model, selected by defining TOON
+#ifdef TOON
+  vec3 NV = normalize(pass_Normal); // normal view
+  vec3 color_Linear;
+  float normal_View_Angle = dot(-normalize(vertex_Position), NV);
 
+  // highlight suns border in a different color
+  if(abs(normal_View_Angle) < 0.1) {
+    color_Linear = vec3(1.0, 0.0, 0.0);
   } else {
-    //out_Color = vec4(vec3(sun_Color).xyz, 1.0);
-    out_Color = texture(ColorTex, texture_Coordinates);
+    // set the sun color
+    color_Linear = vec3(sun_Color).xyz;
   }
+  out_Color = vec4(color_Linear, 1.0);
+#else
+  //out_Color = vec4(vec3(sun_Color).xyz, 1.0);
+  out_Color = texture(ColorTex, vec3(texture_Coordinates * ColorScale, ColorLayer));
+#endif
 }